@@ -0,0 +1,453 @@
+#include "account.hpp"
+
+
+#include "action.hpp"
+
+
+// constructor
+// load the account from the database
+Account::Account(const ID& client_id, Database_Manager& database) : Client_Id(client_id), Database(database), Balance(0), Reserved(0)
+{
+    std::string balance_query = fmt::format(
+        "SELECT balance FROM clients WHERE client_id = {}",
+        Client_Id
+    );
+    Balance = Database.execute_SQL_query_ID(balance_query);
+
+    std::string holdings_query = fmt::format(
+        "SELECT action_id, quantity, average_cost, realized_pnl FROM client_portfolio WHERE client_id = {} ORDER BY action_id ASC",
+        Client_Id
+    );
+    for (const auto& row : Database.execute_SQL_query_vec_strings(holdings_query)){
+        if (row.size() >= 4){
+            Holdings.push_back({std::stoll(row[0]), std::stoi(row[1]), std::stod(row[2]), std::stod(row[3])});
+        }
+    }
+
+    std::string pending_query = fmt::format(
+        "SELECT order_id, quantity, price, action_id, order_type FROM orders WHERE client_id = {} AND order_status = 'PENDING'",
+        Client_Id
+    );
+    for (const auto& row : Database.execute_SQL_query_vec_strings(pending_query)){
+        if (row.size() >= 5){
+            Order_Type order_type = string_to_order_type(row[4]);
+            int quantity = std::stoi(row[1]);
+            ID action_id = std::stoll(row[3]);
+            Money amount = (order_type == Order_Type::BUY) ? std::max<Money>(get_order_cost(Database, quantity, std::stod(row[2]), action_id), 0) : 0;
+            Open_Orders[std::stoll(row[0])] = {order_type, action_id, quantity, amount};
+            Reserved += amount;
+            if (order_type == Order_Type::BUY){
+                Open_Buy_Quantities[action_id] += quantity;
+            }
+        }
+    }
+}
+
+
+// cost of buying a quantity at a price (price = max_number for a market order, valued at the last price with the safety margin), -1 if it would exceed MAX_NOTIONAL
+Money Account::get_order_cost(Database_Manager& database, const int& quantity, const double& price, const ID& action_id)
+{
+    double unit_price = price;
+    if (price == max_number && action_id != -1){
+        unit_price = Action(action_id, database).get_current_price() * safety_percentage;
+    }
+    Price ticks = price_from_double(unit_price, MONEY_TICK_SIZE);
+    if (ticks < Price() || !fits_notional(ticks, quantity, MONEY_TICK_SIZE)){
+        return -1;
+    }
+    return get_notional(ticks, quantity, MONEY_TICK_SIZE);
+}
+
+
+// first holding with an action_id not lower than the given one
+std::vector<Holding>::iterator Account::find_holding(const ID& action_id)
+{
+    return std::lower_bound(Holdings.begin(), Holdings.end(), action_id, [](const Holding& holding, const ID& id){ return holding.action_id < id; });
+}
+
+std::vector<Holding>::const_iterator Account::find_holding(const ID& action_id) const
+{
+    return std::lower_bound(Holdings.begin(), Holdings.end(), action_id, [](const Holding& holding, const ID& id){ return holding.action_id < id; });
+}
+
+// the holding of an action, or an empty one (the lock must be held)
+Holding Account::get_holding_copy(const ID& action_id) const
+{
+    auto it = find_holding(action_id);
+    if (it != Holdings.end() && it->action_id == action_id){
+        return *it;
+    }
+    return {action_id, 0, 0.0, 0.0};
+}
+
+// replace or insert a holding in memory (the lock must be held)
+void Account::set_holding(const Holding& holding)
+{
+    auto it = find_holding(holding.action_id);
+    if (it != Holdings.end() && it->action_id == holding.action_id){
+        *it = holding;
+    }
+    else {
+        Holdings.insert(it, holding);
+    }
+}
+
+
+// cost basis
+// average cost weighted by the bought quantity
+void Account::apply_buy(Holding& holding, const int& quantity, const Money& cost)
+{
+    if (quantity <= 0){
+        return;
+    }
+    int held = std::max(holding.quantity, 0);
+    holding.average_cost = (held * holding.average_cost + money_to_double(cost)) / (held + quantity);
+    holding.quantity += quantity;
+}
+
+// realized P&L against the average cost
+void Account::apply_sell(Holding& holding, const int& quantity, const Money& proceeds)
+{
+    if (quantity <= 0){
+        return;
+    }
+    holding.realized_pnl += money_to_double(proceeds) - quantity * holding.average_cost;
+    holding.quantity -= quantity;
+}
+
+
+// getters
+ID Account::get_client_id() const
+{
+    return Client_Id;
+}
+
+Money Account::get_balance() const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return Balance;
+}
+
+Money Account::get_reserved() const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return Reserved;
+}
+
+// balance that is not reserved by a pending order
+Money Account::get_available_balance() const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return Balance - Reserved;
+}
+
+// check if the action has a row in the portfolio (even with no share left)
+bool Account::has_action(const ID& action_id) const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    auto it = find_holding(action_id);
+    return it != Holdings.end() && it->action_id == action_id;
+}
+
+// number of shares held, 0 if none
+int Account::get_quantity(const ID& action_id) const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    auto it = find_holding(action_id);
+    return (it != Holdings.end() && it->action_id == action_id) ? it->quantity : 0;
+}
+
+// copy of the holdings, sorted by action_id
+std::vector<Holding> Account::get_holdings() const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return Holdings;
+}
+
+// display payloads of the client
+View_Cache& Account::get_views()
+{
+    return Views;
+}
+
+
+// balance management
+// add funds
+void Account::deposit(const Money& amount)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    std::string query = fmt::format(
+        "UPDATE clients SET balance = balance + {} WHERE client_id = {}",
+        amount,
+        Client_Id
+    );
+    Database.execute_SQL(query);
+    Balance += amount;
+    Views.invalidate(Client_View::PORTFOLIO);
+}
+
+// remove funds
+void Account::withdraw(const Money& amount)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    std::string query = fmt::format(
+        "UPDATE clients SET balance = balance - {} WHERE client_id = {}",
+        amount,
+        Client_Id
+    );
+    Database.execute_SQL(query);
+    Balance -= amount;
+    Views.invalidate(Client_View::PORTFOLIO);
+}
+
+// pending orders
+// count a pending order and reserve its funds (0 for a sell order)
+void Account::open_order(const ID& order_id, const Order_Type& order_type, const ID& action_id, const int& quantity, const Money& reserved)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    auto [it, inserted] = Open_Orders.emplace(order_id, Open_Order{order_type, action_id, quantity, reserved});
+    if (inserted){
+        Reserved += reserved;
+        if (order_type == Order_Type::BUY){
+            Open_Buy_Quantities[action_id] += quantity;
+        }
+        Views.invalidate(Client_View::PENDING_ORDERS);
+    }
+}
+
+// forget a pending order and release its funds, nothing if it is not pending
+void Account::close_order(const ID& order_id)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    auto it = Open_Orders.find(order_id);
+    if (it != Open_Orders.end()){
+        Reserved -= it->second.reserved;
+        if (it->second.order_type == Order_Type::BUY){
+            auto buy = Open_Buy_Quantities.find(it->second.action_id);
+            if (buy != Open_Buy_Quantities.end() && (buy->second -= it->second.quantity) <= 0){
+                Open_Buy_Quantities.erase(buy);
+            }
+        }
+        Open_Orders.erase(it);
+        Views.invalidate(Client_View::PENDING_ORDERS);
+    }
+}
+
+int Account::get_open_order_count() const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return static_cast<int>(Open_Orders.size());
+}
+
+
+// pre-trade risk
+void Account::set_risk_limits(const Risk_Limits& limits)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    Limits = limits;
+}
+
+Risk_Limits Account::get_risk_limits() const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return Limits;
+}
+
+// check a new order against the limits (counts it for the order rate)
+// a few comparisons and two hash lookups : constant time, whatever the size of the account
+Risk_Check Account::check_order_risk(const Order_Type& order_type, const ID& action_id, const int& quantity, const Money& notional)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex); // the rate limiter is updated
+    if (!Rate_Limiter.take(Limits.max_orders_per_second)){
+        return Risk_Check::ORDER_RATE;
+    }
+    if (quantity > Limits.max_order_quantity){
+        return Risk_Check::ORDER_QUANTITY;
+    }
+    if (notional < 0 || notional > Limits.max_notional){
+        return Risk_Check::NOTIONAL;
+    }
+    if (static_cast<int>(Open_Orders.size()) >= Limits.max_open_orders){
+        return Risk_Check::OPEN_ORDERS;
+    }
+    if (order_type == Order_Type::BUY && Limits.max_position != std::numeric_limits<int>::max()){
+        auto holding = find_holding(action_id);
+        long long position = (holding != Holdings.end() && holding->action_id == action_id) ? holding->quantity : 0;
+        auto buy = Open_Buy_Quantities.find(action_id);
+        position += (buy != Open_Buy_Quantities.end()) ? buy->second : 0;
+        if (position + quantity > Limits.max_position){
+            return Risk_Check::POSITION;
+        }
+    }
+    return Risk_Check::ACCEPTED;
+}
+
+
+// portfolio management
+// add shares of an action bought at a price
+void Account::add_shares(const ID& action_id, const int& quantity, const Price& price)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    Holding holding = get_holding_copy(action_id);
+    apply_buy(holding, quantity, get_notional(price, quantity, MONEY_TICK_SIZE));
+    // the row is created on the first buy, otherwise the quantity is added
+    std::string query = fmt::format(
+        "INSERT INTO client_portfolio (client_id, action_id, quantity, average_cost) VALUES ({}, {}, {}, {}) ON CONFLICT(client_id, action_id) DO UPDATE SET quantity = quantity + excluded.quantity, average_cost = excluded.average_cost",
+        Client_Id,
+        action_id,
+        quantity,
+        holding.average_cost
+    );
+    Database.execute_SQL(query);
+    set_holding(holding);
+    Views.invalidate(Client_View::PORTFOLIO);
+}
+
+// remove shares of an action sold at a price, never below 0
+void Account::remove_shares(const ID& action_id, const int& quantity, const Price& price)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    auto it = find_holding(action_id);
+    // if the action is in the portfolio, we remove the quantity
+    if (it != Holdings.end() && it->action_id == action_id){
+        int sold = std::min(quantity, std::max(it->quantity, 0));
+        Holding holding = *it;
+        apply_sell(holding, sold, get_notional(price, sold, MONEY_TICK_SIZE));
+        std::string query = fmt::format(
+            "UPDATE client_portfolio SET quantity = MAX(quantity - {}, 0), realized_pnl = {} WHERE client_id = {} AND action_id = {}",
+            quantity,
+            holding.realized_pnl,
+            Client_Id,
+            action_id
+        );
+        Database.execute_SQL(query);
+        *it = holding;
+        Views.invalidate(Client_View::PORTFOLIO);
+    }
+}
+
+
+// funds of a pending buy order freed by a fill of a quantity of it, 0 if it is not a pending buy (the lock must be held)
+// the reservation is released in proportion of the filled quantity (rounded down), all of it once the order is filled
+Money Account::get_released(const ID& order_id, const int& quantity) const
+{
+    auto it = Open_Orders.find(order_id);
+    if (it == Open_Orders.end() || it->second.order_type != Order_Type::BUY || it->second.quantity <= 0 || quantity <= 0){
+        return 0;
+    }
+    if (quantity >= it->second.quantity){
+        return it->second.reserved;
+    }
+    // reserved x quantity / open quantity, without the product that could exceed an int64
+    Money reserved = it->second.reserved;
+    int open = it->second.quantity;
+    return reserved / open * quantity + reserved % open * quantity / open;
+}
+
+// a quantity of a pending order was filled : its count and reservation shrink, forgotten once filled (the lock must be held)
+void Account::fill_open_order(const ID& order_id, const int& quantity)
+{
+    auto it = Open_Orders.find(order_id);
+    if (it == Open_Orders.end()){
+        return;
+    }
+    Money released = get_released(order_id, quantity);
+    int filled = std::min(quantity, it->second.quantity);
+    Reserved -= released;
+    it->second.reserved -= released;
+    it->second.quantity -= filled;
+    if (it->second.order_type == Order_Type::BUY){
+        auto buy = Open_Buy_Quantities.find(it->second.action_id);
+        if (buy != Open_Buy_Quantities.end() && (buy->second -= filled) <= 0){
+            Open_Buy_Quantities.erase(buy);
+        }
+    }
+    if (it->second.quantity <= 0){
+        Open_Orders.erase(it);
+    }
+    Views.invalidate(Client_View::PENDING_ORDERS);
+}
+
+
+// settlement
+// cash and share legs of a fill of a pending order (-1 : none) in one transaction, false if a guard fails
+// the reserved funds are not a column : the cash guard binds the in-memory reservation, read under the exclusive account lock,
+// so the lock held from the check to the memory update is what serializes the fills of a client, the SQL guard only keeps the
+// database from going below the reservation if another writer moved the balance
+// a buy may spend the part of the reservation of its own order that the fill releases
+bool Account::settle(const Order_Type& order_type, const ID& action_id, const int& quantity, const Price& price, const ID& order_id)
+{
+    if (quantity <= 0 || price < Price() || !fits_notional(price, quantity, MONEY_TICK_SIZE)){
+        return false;
+    }
+    Money amount = get_notional(price, quantity, MONEY_TICK_SIZE); // exact, the balance never drifts
+
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    SQL_Transaction transaction(Database);
+    if (order_type == Order_Type::BUY){
+        // cash leg : the funds reserved by the other pending buy orders (and by what is left of this one) can not be spent
+        std::string cash_query = fmt::format(
+            "UPDATE clients SET balance = balance - {} WHERE client_id = {} AND balance - {} >= {}",
+            amount,
+            Client_Id,
+            Reserved - get_released(order_id, quantity),
+            amount
+        );
+        if (Database.execute_SQL_changes(cash_query) != 1){
+            return false; // the transaction is rolled back
+        }
+        // share leg, with the new average cost
+        Holding holding = get_holding_copy(action_id);
+        apply_buy(holding, quantity, amount);
+        std::string shares_query = fmt::format(
+            "INSERT INTO client_portfolio (client_id, action_id, quantity, average_cost) VALUES ({}, {}, {}, {}) ON CONFLICT(client_id, action_id) DO UPDATE SET quantity = quantity + excluded.quantity, average_cost = excluded.average_cost",
+            Client_Id,
+            action_id,
+            quantity,
+            holding.average_cost
+        );
+        if (Database.execute_SQL_changes(shares_query) != 1){
+            return false;
+        }
+        transaction.commit();
+
+        Balance -= amount;
+        set_holding(holding);
+        fill_open_order(order_id, quantity);
+        Views.invalidate(Client_View::PORTFOLIO);
+        return true;
+    }
+    else if (order_type == Order_Type::SELL){
+        // share leg : never sell more than held, the realized P&L moves with it
+        Holding holding = get_holding_copy(action_id);
+        apply_sell(holding, quantity, amount);
+        std::string shares_query = fmt::format(
+            "UPDATE client_portfolio SET quantity = quantity - {}, realized_pnl = {} WHERE client_id = {} AND action_id = {} AND quantity >= {}",
+            quantity,
+            holding.realized_pnl,
+            Client_Id,
+            action_id,
+            quantity
+        );
+        if (Database.execute_SQL_changes(shares_query) != 1){
+            return false;
+        }
+        // cash leg
+        std::string cash_query = fmt::format(
+            "UPDATE clients SET balance = balance + {} WHERE client_id = {}",
+            amount,
+            Client_Id
+        );
+        if (Database.execute_SQL_changes(cash_query) != 1){
+            return false;
+        }
+        transaction.commit();
+
+        Balance += amount;
+        set_holding(holding); // the row exists, the guarded UPDATE found it
+        fill_open_order(order_id, quantity);
+        Views.invalidate(Client_View::PORTFOLIO);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,101 @@
+//=======================================================================
+// File that contains the in-memory state of a client account
+//=======================================================================
+#ifndef ACCOUNT_HPP
+#define ACCOUNT_HPP
+#include "database_management.hpp"
+#include "order.hpp"
+
+
+// position of a client on one action, as in the "client_portfolio" table
+struct Holding
+{
+    ID action_id;
+    int quantity;
+    double average_cost; // weighted average price of the shares held, moved by the buys only
+    double realized_pnl; // (sell price - average cost) x quantity, summed over the sells
+};
+
+
+// pending order of a client, as needed by the reservation and the risk checks
+struct Open_Order
+{
+    Order_Type order_type;
+    ID action_id;
+    int quantity;
+    Money reserved; // funds reserved for a buy order, 0 for a sell order
+};
+
+
+// balance, reserved funds and holdings of one client, shared by every Client handle of that id
+// reads never touch SQLite, writes update the database first and then the memory (write-through)
+// the cash is counted in Money and the fill prices in Price (of MONEY_TICK_SIZE ticks) : the balance never drifts,
+// the cost basis (average cost, realized P&L) is an average and stays a double
+class Account
+{
+private:
+    ID Client_Id; // client owning the account
+    Database_Manager& Database; // reference to the database manager for the write-through
+    mutable std::shared_mutex Mutex; // readers share the account, a write is exclusive
+    Money Balance; // cash balance, as in the "clients" table
+    Money Reserved; // funds promised to the pending buy orders
+    std::vector<Holding> Holdings; // flat map sorted by action_id
+    std::unordered_map<ID, Open_Order> Open_Orders; // order_id -> pending order
+    std::unordered_map<ID, int> Open_Buy_Quantities; // action_id -> shares of the pending buy orders
+    Risk_Limits Limits; // pre-trade risk limits of the client
+    Order_Rate_Limiter Rate_Limiter; // orders per second
+    View_Cache Views; // display payloads of the client, invalidated by the writes below
+
+    std::vector<Holding>::iterator find_holding(const ID& action_id); // first holding with an action_id not lower than the given one
+    std::vector<Holding>::const_iterator find_holding(const ID& action_id) const;
+    Holding get_holding_copy(const ID& action_id) const; // the holding of an action, or an empty one (the lock must be held)
+    void set_holding(const Holding& holding); // replace or insert a holding in memory (the lock must be held)
+    Money get_released(const ID& order_id, const int& quantity) const; // funds of a pending buy order freed by a fill of a quantity of it, 0 if it is not a pending buy (the lock must be held)
+    void fill_open_order(const ID& order_id, const int& quantity); // a quantity of a pending order was filled : its count and reservation shrink, forgotten once filled (the lock must be held)
+
+    // cost basis, applied in memory before the write so the database gets the same values
+    static void apply_buy(Holding& holding, const int& quantity, const Money& cost); // average cost weighted by the bought quantity
+    static void apply_sell(Holding& holding, const int& quantity, const Money& proceeds); // realized P&L against the average cost
+
+public:
+    // constructor
+    Account(const ID& client_id, Database_Manager& database); // load the account from the database
+
+    // cost of buying a quantity at a price (price = max_number for a market order, valued at the last price with the safety margin), -1 if it would exceed MAX_NOTIONAL
+    static Money get_order_cost(Database_Manager& database, const int& quantity, const double& price, const ID& action_id);
+
+    // getters
+    ID get_client_id() const;
+    Money get_balance() const;
+    Money get_reserved() const;
+    Money get_available_balance() const; // balance that is not reserved by a pending order
+    bool has_action(const ID& action_id) const; // check if the action has a row in the portfolio (even with no share left)
+    int get_quantity(const ID& action_id) const; // number of shares held, 0 if none
+    std::vector<Holding> get_holdings() const; // copy of the holdings, sorted by action_id
+    View_Cache& get_views(); // display payloads of the client
+
+    // balance management
+    void deposit(const Money& amount); // add funds
+    void withdraw(const Money& amount); // remove funds
+
+    // pending orders
+    void open_order(const ID& order_id, const Order_Type& order_type, const ID& action_id, const int& quantity, const Money& reserved); // count a pending order and reserve its funds (0 for a sell order)
+    void close_order(const ID& order_id); // forget a pending order and release its funds, nothing if it is not pending
+    int get_open_order_count() const;
+
+    // pre-trade risk : in-memory counters only, no SQL on the order path
+    void set_risk_limits(const Risk_Limits& limits);
+    Risk_Limits get_risk_limits() const;
+    Risk_Check check_order_risk(const Order_Type& order_type, const ID& action_id, const int& quantity, const Money& notional); // check a new order against the limits (counts it for the order rate), a negative notional is refused
+
+    // portfolio management
+    void add_shares(const ID& action_id, const int& quantity, const Price& price); // add shares of an action bought at a price
+    void remove_shares(const ID& action_id, const int& quantity, const Price& price); // remove shares of an action sold at a price, never below 0
+
+    // settlement
+    friend class Settlement_Batch; // locks the accounts of a batch and applies the net positions once committed
+    bool settle(const Order_Type& order_type, const ID& action_id, const int& quantity, const Price& price, const ID& order_id = -1); // cash and share legs of a fill of a pending order (-1 : none) in one transaction, false if a guard fails (or if the notional exceeds MAX_NOTIONAL)
+};
+
+
+#endif // ACCOUNT_HPP
@@ -18,11 +18,9 @@ ID Action::get_action_id() const
 // get the current price of the action
 double Action::get_current_price() const
 {
-    std::string query = fmt::format(
-        "SELECT price FROM prices WHERE action_id = {} ORDER BY date_time DESC, daily_time DESC LIMIT 1",
-        get_action_id()
-    );
-    return Database.execute_SQL_query_double(query);
+    // the cache follows every recorded fill, including the ones aggregated in the current tick
+    std::optional<Price_Point> latest_price = Database.get_latest_price(get_action_id());
+    return latest_price ? latest_price->price : -1.0; // -1 if no price, as the former query
 }
 
 
@@ -0,0 +1,121 @@
+#include "change_feed.hpp"
+
+
+// Change_Subscriber
+// constructor
+// simple init
+Change_Subscriber::Change_Subscriber(const Change_Feed& feed, const uint64_t& cursor) : Feed(feed), Cursor(cursor), Lost_Events(0)
+{
+
+}
+
+
+// getters
+uint64_t Change_Subscriber::get_lost_events() const
+{
+    return Lost_Events;
+}
+
+
+// reading
+// get the next event, false if there is none yet
+bool Change_Subscriber::poll(Change_Event& event)
+{
+    while (true){
+        const Change_Feed::Slot& slot = Feed.Slots[Cursor & Feed.Mask];
+        uint64_t sequence = slot.Sequence.load(std::memory_order_acquire);
+        if (sequence == Cursor + 1){
+            event = slot.Event;
+            // seqlock check : if a producer wrapped around and rewrote the slot during the copy, the event is discarded
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.Sequence.load(std::memory_order_relaxed) == sequence){
+                ++Cursor;
+                return true;
+            }
+        }
+
+        // the subscriber fell more than a ring behind the producers : jump to the oldest event still stored
+        uint64_t published = Feed.Write_Sequence.load(std::memory_order_acquire);
+        if (published > Cursor + Feed.Slots.size()){
+            uint64_t oldest = published - Feed.Slots.size();
+            Lost_Events += oldest - Cursor;
+            Cursor = oldest;
+            continue;
+        }
+        return false; // the next event is not published yet
+    }
+}
+
+
+// Change_Feed
+// constructor
+// capacity is rounded up to a power of two
+Change_Feed::Change_Feed(const size_t& capacity) : Slots(std::bit_ceil(std::max<size_t>(capacity, 2))), Mask(Slots.size() - 1)
+{
+
+}
+
+
+// getters
+uint64_t Change_Feed::get_published_events() const
+{
+    return Write_Sequence.load(std::memory_order_acquire);
+}
+
+
+// writing and reading
+// add an event to the ring, waits only while the producer of the previous lap of the slot is still writing it
+void Change_Feed::publish(const Change_Event& event)
+{
+    uint64_t sequence = Write_Sequence.fetch_add(1, std::memory_order_acq_rel);
+    Slot& slot = Slots[sequence & Mask];
+    // two producers a capacity apart share the slot : the later one takes it only once the earlier one published its event,
+    // so their copies never interleave (the slot is empty on the first lap)
+    uint64_t previous = (sequence < Slots.size()) ? 0 : sequence - Slots.size() + 1;
+    while (slot.Sequence.load(std::memory_order_acquire) != previous){
+        std::this_thread::yield();
+    }
+    slot.Sequence.store(SLOT_WRITING, std::memory_order_relaxed); // readers ignore the slot while it is being written
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.Event = event;
+    slot.Sequence.store(sequence + 1, std::memory_order_release);
+}
+
+// start reading from the next published event
+Change_Subscriber Change_Feed::subscribe() const
+{
+    return Change_Subscriber(*this, get_published_events());
+}
+
+
+// converting a Change_Table enum to a string
+std::string change_table_to_string(const Change_Table& table)
+{
+    switch (table){
+        case Change_Table::ORDERS:
+            return "orders";
+        case Change_Table::PRICES:
+            return "prices";
+        case Change_Table::CLIENT_PORTFOLIO:
+            return "client_portfolio";
+        case Change_Table::CLIENTS:
+            return "clients";
+        default:
+            return "unknown";
+    }
+}
+
+// converting a Change_Operation enum to a string
+std::string change_operation_to_string(const Change_Operation& operation)
+{
+    switch (operation){
+        case Change_Operation::INSERT:
+            return "INSERT";
+        case Change_Operation::UPDATE:
+            return "UPDATE";
+        case Change_Operation::DELETE:
+            return "DELETE";
+        default:
+            return "UNKNOWN";
+    }
+}
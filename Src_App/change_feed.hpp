@@ -0,0 +1,105 @@
+//==========================================================================
+// File that defines the change-data-capture feed of the database
+//==========================================================================
+#ifndef CHANGE_FEED_HPP
+#define CHANGE_FEED_HPP
+#include "utility.hpp"
+#include "price.hpp"
+
+
+#define CHANGE_FEED_CAPACITY 4096 // number of events kept in the ring (power of two), a slower subscriber loses the oldest ones
+
+
+enum class Change_Table
+{
+    ORDERS,
+    PRICES,
+    CLIENT_PORTFOLIO,
+    CLIENTS
+};
+
+enum class Change_Operation
+{
+    INSERT,
+    UPDATE,
+    DELETE
+};
+
+
+// one row change, only the columns of its table are meaningful (the others stay at -1)
+struct Change_Event
+{
+    Change_Table table;
+    Change_Operation operation;
+    ID key = -1;              // rowid of the changed row (order_id for "orders", price_id for "prices", client_id for "clients")
+    ID client_id = -1;        // orders, client_portfolio, clients
+    ID action_id = -1;        // orders, prices, client_portfolio
+    int quantity = -1;        // orders, client_portfolio
+    double price = -1.0;      // orders, prices
+    Money balance = -1;       // clients, in money units
+    ID date_time = -1;        // orders (order_time_date), prices
+    ID daily_time = -1;       // orders (order_time_daily), prices
+    bool is_pending = false;  // orders : PENDING or COMPLETED
+};
+
+
+class Change_Feed;
+
+// read cursor of one subscriber, each subscriber sees every event published after its subscription
+class Change_Subscriber
+{
+private:
+    const Change_Feed& Feed; // ring read by the subscriber
+    uint64_t Cursor; // sequence number of the next event to read
+    uint64_t Lost_Events; // events overwritten before they were read
+
+public:
+    // constructor
+    Change_Subscriber(const Change_Feed& feed, const uint64_t& cursor); // simple init
+
+    // getters
+    uint64_t get_lost_events() const;
+
+    // reading
+    bool poll(Change_Event& event); // get the next event, false if there is none yet
+};
+
+
+// bounded multi-producer ring broadcasting the events to every subscriber without locks
+// a producer claims a sequence number, then waits until the slot holds the event of the previous lap before rewriting it (as in a Vyukov ring),
+// the subscribers never hold the producers back : they check the slot sequence again after the copy and drop an event rewritten meanwhile
+class Change_Feed
+{
+private:
+    static constexpr uint64_t SLOT_WRITING = UINT64_MAX; // sequence of a slot being written, no reader ever expects it
+    struct Slot
+    {
+        std::atomic<uint64_t> Sequence{0}; // sequence + 1 of the event stored in the slot, 0 while empty, SLOT_WRITING while it is being written
+        Change_Event Event;
+    };
+    std::vector<Slot> Slots;
+    uint64_t Mask; // capacity - 1
+    std::atomic<uint64_t> Write_Sequence{0}; // sequence number of the next event to publish
+
+    friend class Change_Subscriber;
+
+public:
+    // constructor
+    Change_Feed(const size_t& capacity = CHANGE_FEED_CAPACITY); // capacity is rounded up to a power of two
+
+    // getters
+    uint64_t get_published_events() const;
+
+    // writing and reading
+    void publish(const Change_Event& event); // add an event to the ring, waits only while the producer of the previous lap of the slot is still writing it
+    Change_Subscriber subscribe() const; // start reading from the next published event
+};
+
+
+// converting a Change_Table enum to a string
+std::string change_table_to_string(const Change_Table& table);
+// converting a Change_Operation enum to a string
+std::string change_operation_to_string(const Change_Operation& operation);
+
+
+#endif // CHANGE_FEED_HPP
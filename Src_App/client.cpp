@@ -3,7 +3,7 @@
 
 // constructor
 // simple init
-Client::Client(const ID& id, Database_Manager& database) : Id(id), Database(database)
+Client::Client(const ID& id, Database_Manager& database) : Id(id), Database(database), Client_Account(database.get_account(id))
 {
 
 }
@@ -17,36 +17,38 @@ ID Client::get_id() const
 
 double Client::get_balance() const
 {   
-    std::string query = fmt::format(
-        "SELECT balance FROM clients WHERE client_id = {}",
-        get_id()
-    );
-    return Database.execute_SQL_query_double(query);
+    return money_to_double(Client_Account->get_balance());
 }
 
 
 // check if an action is in the portfolio
 bool Client::is_action_in_portfolio(const ID& action_id) const
 {   
+    return Client_Account->has_action(action_id);
+}
+
+// compare an encrypted password with the stored one without copying the blob
+bool Client::is_password_correct(const std::string& encrypted_password) const
+{
     std::string query = fmt::format(
-        "SELECT action_id FROM client_portfolio WHERE client_id = {} AND action_id = {}",
-        get_id(), action_id
+        "SELECT encrypted_password FROM clients WHERE client_id = {}",
+        get_id()
     );
-    return Database.execute_SQL_query_ID(query) == action_id;
+    bool is_correct = false;
+    Database.execute_SQL_query_blob_view(query, [&](std::span<const unsigned char> stored_password){
+        is_correct = stored_password.size() == encrypted_password.size()
+            && std::memcmp(stored_password.data(), encrypted_password.data(), encrypted_password.size()) == 0;
+    });
+    return is_correct;
 }
 
 
-// balance management:
+// balance management: the amounts are converted to Money here, the account counts them exactly
 // deposit funds into the account
 void Client::deposit(const double& amount)
 {
     if (amount > 0){
-        std::string query = fmt::format(
-            "UPDATE clients SET balance = balance + {} WHERE client_id = {}",
-            amount, 
-            get_id()
-        );
-        Database.execute_SQL(query);
+        Client_Account->deposit(money_from_double(amount));
     }
 }
 
@@ -54,60 +56,32 @@ void Client::deposit(const double& amount)
 void Client::withdraw(const double& amount)
 {   
     // we already make sure that the amount is positive in can_afford, so we don't check it here
-    std::string query = fmt::format(
-        "UPDATE clients SET balance = balance - {} WHERE client_id = {}",
-        amount, 
-        get_id()
-    );
-    Database.execute_SQL(query);
+    Client_Account->withdraw(money_from_double(amount));
 }
 
 // returns True if the amount can be withdrawn
 bool Client::can_afford(const int& quantity, const double& price, const ID& action_id) const
 {   
-    double amount = quantity * price;
-    if (price == max_number && action_id != -1){
-        std::string price_query = fmt::format(
-            "SELECT price FROM prices WHERE action_id = {} ORDER BY date_time DESC, daily_time DESC LIMIT 1",
-            action_id
-        );
-        double current_price = Database.execute_SQL_query_double(price_query);
-        amount = current_price * safety_percentage;
-    }
+    Money amount = Account::get_order_cost(Database, quantity, price, action_id);
     if (amount < 0){
         return false;
     }
-    std::string query = fmt::format(
-        R"(SELECT c.balance - COALESCE((
-                SELECT SUM(o.quantity * 
-                    CASE 
-                        WHEN o.order_type = 'MARKET' THEN (
-                            SELECT p.price * {}
-                            FROM prices p
-                            WHERE p.action_id = o.action_id
-                            AND (p.date_time, p.daily_time) = (
-                                SELECT p2.date_time, p2.daily_time FROM prices p2
-                                WHERE p2.action_id = o.action_id
-                                AND p2.date_time = (SELECT MAX(p3.date_time) FROM prices p3 WHERE p3.action_id = o.action_id)
-                                AND p2.daily_time = (SELECT MAX(p3.daily_time) FROM prices p3 WHERE p3.action_id = o.action_id AND p3.date_time = p2.date_time)
-                            )
-                        )
-                        ELSE o.price
-                    END
-                )
-                FROM orders o
-                WHERE o.client_id = c.client_id AND o.order_status = 'PENDING'
-            ), 0)
-        FROM clients c
-        WHERE c.client_id = {})",
-        safety_percentage,
-        get_id()
-    );
-    double available_balance = Database.execute_SQL_query_double(query); // a pending order can be executed at any time, and then substrated from the balance, so for it to remains positive, we need to substract the pending orders from the balance
-    return amount <= available_balance;
+    return amount <= Client_Account->get_available_balance(); // a pending order can be executed at any time, and then substrated from the balance, so the funds of the pending buy orders are reserved
 }
 
 
+
+// pre-trade risk:
+// check a new order against the client's risk limits, before can_afford / has_shares
+Risk_Check Client::check_order_risk(const Order_Type& order_type, const int& quantity, const ID& action_id, const double& price) const
+{
+    if (quantity <= 0){
+        return Risk_Check::ORDER_QUANTITY;
+    }
+    Money notional = Account::get_order_cost(Database, quantity, price, action_id); // a market order is valued at the cached last price, -1 (refused) if too large
+    return Client_Account->check_order_risk(order_type, action_id, quantity, notional);
+}
+
 // completed orders management:
 // add an order to the client's list of orders
 void Client::add_completed_order(const ID& order_id, const ID& order_time_date, const ID& order_time_daily, const Order_Type& order_type, const int& quantity, const ID& action_id, const Order_Trigger& trigger_type, const double& price, const double& trigger_price_lower, const double& trigger_price_upper, const ID& expiration_time_date, const ID& expiration_time_daily)
@@ -132,7 +106,7 @@ void Client::add_completed_order(const ID& order_id, const ID& order_time_date,
         expiration_time_date,
         expiration_time_daily
     );
-    Database.execute_SQL(query);
+    Database.execute_SQL_routed(action_id, query);
 }
 
 
@@ -160,7 +134,10 @@ void Client::add_pending_order(const ID& order_id, const ID& order_time_date, co
         expiration_time_date,
         expiration_time_daily
     );
-    Database.execute_SQL(query);
+    Database.execute_SQL_routed(action_id, query);
+    // the funds of a pending buy order are reserved until it is executed or removed
+    Money reserved = (order_type == Order_Type::BUY) ? std::max<Money>(Account::get_order_cost(Database, quantity, price, action_id), 0) : 0;
+    Client_Account->open_order(order_id, order_type, action_id, quantity, reserved);
 }
 
 // remove a pending order by order id
@@ -171,7 +148,8 @@ void Client::remove_pending_order(const ID& order_id)
         order_id,
         get_id()
     );
-    Database.execute_SQL(query);
+    Database.execute_SQL_all_shards(query); // the order id does not tell which shard holds the order
+    Client_Account->close_order(order_id);
 }
 
 
@@ -179,112 +157,44 @@ void Client::remove_pending_order(const ID& order_id)
 // add a quantity for a specific action and update its price if necessary
 void Client::add_action(const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time)
 {
-    // if the action is already in the portfolio, we add the quantity
-    if (is_action_in_portfolio(action_id)){
-        std::string query = fmt::format(
-            "UPDATE client_portfolio SET quantity = quantity + {} WHERE client_id = {} AND action_id = {}",
-            quantity, 
-            get_id(), 
-            action_id
-        );
-        Database.execute_SQL(query);
-    }
-    // otherwise, we add the action to the portfolio
-    else{
-        std::string query = fmt::format(
-            "INSERT INTO client_portfolio (client_id, action_id, quantity) VALUES ({}, {}, {})",
-            get_id(), 
-            action_id, 
-            quantity
-        );
-        Database.execute_SQL(query);
-    }
+    Client_Account->add_shares(action_id, quantity, price_from_double(price, MONEY_TICK_SIZE));
 
-    // check if the price and time already exist in the prices table
-    std::string check_query = fmt::format(
-        "SELECT 1 FROM prices WHERE action_id = {} AND price = {} AND daily_time = {} AND date_time = {} LIMIT 1",
-        action_id, 
-        price, 
-        daily_time, 
-        date_time
-    );
-    std::vector<std::vector<std::string>> existing_price = Database.execute_SQL_query_vec_strings(check_query);
-    // if no matching price-time exists, insert the new price-time
-    if (existing_price.empty()){
-        std::string query = fmt::format(
-            "INSERT INTO prices (action_id, price, daily_time, date_time) VALUES ({}, {}, {}, {})",
-            action_id, 
-            price, 
-            daily_time, 
-            date_time
-        );
-        Database.execute_SQL(query);
-    }
+    // record the fill (the buying leg counts the traded quantity)
+    Database.record_price(action_id, quantity, price, daily_time, date_time);
 }
 
 // remove a quantity for a specific action and update its price if necessary
 void Client::remove_action(const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time)
 {
-    // if the action is in the portfolio, we remove the quantity
-    if (is_action_in_portfolio(action_id)){
-        std::string query = fmt::format(
-            "UPDATE client_portfolio SET quantity = MAX(quantity - {}, 0) WHERE client_id = {} AND action_id = {}",
-            quantity, 
-            get_id(), 
-            action_id
-        );
-        Database.execute_SQL(query);
-    }
+    Client_Account->remove_shares(action_id, quantity, price_from_double(price, MONEY_TICK_SIZE));
 
-    // check if the price and time already exist in the prices table
-    std::string check_query = fmt::format(
-        "SELECT 1 FROM prices WHERE action_id = {} AND price = {} AND daily_time = {} AND date_time = {} LIMIT 1",
-        action_id, 
-        price, 
-        daily_time, 
-        date_time
-    );
-    std::vector<std::vector<std::string>> existing_price = Database.execute_SQL_query_vec_strings(check_query);
-    // if no matching price-time exists, insert the new price-time
-    if (existing_price.empty()){
-        std::string query = fmt::format(
-            "INSERT INTO prices (action_id, price, daily_time, date_time) VALUES ({}, {}, {}, {})",
-            action_id, 
-            price, 
-            daily_time, 
-            date_time
-        );
-        Database.execute_SQL(query);
-    }
+    // record the fill price (the traded quantity is counted by the buying leg)
+    Database.record_price(action_id, 0, price, daily_time, date_time);
 }
 
 // returns True if the action can be removed
 bool Client::has_shares(const ID& action_id, const int& quantity) const
 {
-    std::string query = fmt::format(
-        "SELECT quantity FROM client_portfolio WHERE client_id = {} AND action_id = {}",
-        get_id(), 
-        action_id
-    );
-    return quantity > 0 && quantity <= Database.execute_SQL_query_int(query);
+    return quantity > 0 && quantity <= Client_Account->get_quantity(action_id);
 }
 
-// update the portfolio with a new action (modify the client balance also)
-void Client::update_portfolio(const Order_Type& order_type, const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time)
+// update the portfolio with a fill of a pending order (-1 : none), modify the client balance also
+void Client::update_portfolio(const Order_Type& order_type, const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time, const ID& order_id)
 {
     if (order_type == Order_Type::BUY){
-        if (can_afford(quantity, price, action_id)){
-            withdraw(price * quantity);
-            add_action(action_id, quantity, price, daily_time, date_time);
+        // the balance check and the debit are made under the account lock, with the reservation of the filled order released, see Account::settle
+        if (Client_Account->settle(order_type, action_id, quantity, price_from_double(price, MONEY_TICK_SIZE), order_id)){
+            // record the fill (the buying leg counts the traded quantity)
+            Database.record_price(action_id, quantity, price, daily_time, date_time);
         }
         else {
             std::cerr << "Error: Insufficient balance for buying.\n";
         }
     }
     else if (order_type == Order_Type::SELL){
-        if (has_shares(action_id, quantity)){
-            deposit(price * quantity);
-            remove_action(action_id, quantity, price, daily_time, date_time);
+        if (Client_Account->settle(order_type, action_id, quantity, price_from_double(price, MONEY_TICK_SIZE), order_id)){
+            // record the fill price (the traded quantity is counted by the buying leg)
+            Database.record_price(action_id, 0, price, daily_time, date_time);
         }
         else {
             std::cerr << "Error: Failed to sell action.\n";
@@ -292,110 +202,105 @@ void Client::update_portfolio(const Order_Type& order_type, const ID& action_id,
     }
 }
 
-
 // string representation methods
+// the pending orders and the portfolio are served from the cache of the account : a repeated display is a copy, the payload is rendered again only after a change of the client (or of a price for the portfolio)
+// the completed orders are not cached : the history only grows, the server streams it by pages with send_completed_orders
 // get the completed orders info as a string : order_time_date order_time_daily client_name order_type quantity action_name trigger_type price trigger_price_lower trigger_price_upper expiration_time_date expiration_time_daily,...
+// the whole history at once, prefer send_completed_orders for an active client
 std::string Client::get_completed_orders_info() const
-{   
-    std::string query = fmt::format(
-        R"(SELECT o.order_time_date, o.order_time_daily, c.name, o.order_type, o.quantity, a.name, o.trigger_type, o.price, o.trigger_price_lower, o.trigger_price_upper, o.expiration_time_date, o.expiration_time_daily
-          FROM orders o JOIN actions a ON o.action_id = a.action_id JOIN clients c ON o.client_id = c.client_id
-          WHERE o.client_id = {} AND o.order_status = 'COMPLETED')",
-        get_id()
-    );
-    std::vector<std::vector<std::string>> completed_orders_info = Database.execute_SQL_query_vec_strings(query);
-    
-    // check if we have enough data before accessing elements
-    if (completed_orders_info.empty()){
-        return ""; // return empty if data is missing
-    }
-    
-    std::string result;
-    for (const auto& order : completed_orders_info){
-        if (order.size() >= 12){
-            result += fmt::format(
-                "{} {} {} {} {} {} {} {} {} {},",
-                two_times_to_string(std::stoll(order[0]), std::stoll(order[1])),
-                order[2],
-                order[3],
-                order[4],
-                order[5],
-                order[6],
-                order[7],
-                order[8],
-                order[9],
-                two_times_to_string(std::stoll(order[10]), std::stoll(order[11]))
-            );
-        }
-    }
-    if (!result.empty()){
-        result.pop_back(); // remove trailing comma
+{
+    Order_List_Renderer renderer;
+    Order_History_Cursor cursor;
+    while (!cursor.done){
+        get_completed_orders_page(renderer, cursor);
     }
-    return result;
+    return renderer.to_string();
 }
 
-// get the pending orders info as a string : order_time_date order_time_daily client_name order_type quantity action_name trigger_type price trigger_price_lower trigger_price_upper expiration_time_date expiration_time_daily,...
+// get the pending orders info as a string : same format
 std::string Client::get_pending_orders_info() const
-{   
+{
+    return Client_Account->get_views().get(Client_View::PENDING_ORDERS, 0, [this](){ return render_pending_orders_info(); });
+}
+
+// get the portfolio info as a string : value balance,action_name_1 quantity1 last_price1 last_time1 average_cost1 unrealized_pnl1 realized_pnl1,...
+std::string Client::get_portfolio_info() const
+{
+    // the payload only depends on the prices of the held actions : the fills of the other actions keep it cached
+    std::vector<ID> action_ids;
+    for (const Holding& holding : Client_Account->get_holdings()){
+        action_ids.push_back(holding.action_id);
+    }
+    return Client_Account->get_views().get(Client_View::PORTFOLIO, Database.get_market_version(action_ids), [this](){ return render_portfolio_info(); });
+}
+
+// append the next page of completed orders to the renderer (same format) and move the cursor, returns the number of orders
+// keyset pagination : the page starts after the cursor in the "orders_history" index, whatever the number of orders already read
+int Client::get_completed_orders_page(Order_List_Renderer& renderer, Order_History_Cursor& cursor, const int& page_size) const
+{
+    if (cursor.done){
+        return 0;
+    }
     std::string query = fmt::format(
-        R"(SELECT o.order_time_date, o.order_time_daily, c.name, o.order_type, o.quantity, a.name, o.trigger_type, o.price, o.trigger_price_lower, o.trigger_price_upper, o.expiration_time_date, o.expiration_time_daily
+        R"(SELECT {}
           FROM orders o JOIN actions a ON o.action_id = a.action_id JOIN clients c ON o.client_id = c.client_id
-          WHERE o.client_id = {} AND o.order_status = 'PENDING')",
-        get_id()
+          WHERE o.client_id = {} AND o.order_status = 'COMPLETED' AND (o.order_time_date, o.order_time_daily, o.order_id) > ({}, {}, {})
+          ORDER BY o.order_time_date, o.order_time_daily, o.order_id
+          LIMIT {})",
+        ORDER_LIST_COLUMNS,
+        get_id(),
+        cursor.order_time_date,
+        cursor.order_time_daily,
+        cursor.order_id,
+        page_size
     );
-    std::vector<std::vector<std::string>> completed_orders_info = Database.execute_SQL_query_vec_strings(query);
-    
-    // check if we have enough data before accessing elements
-    if (completed_orders_info.empty()){
-        return ""; // return empty if data is missing
-    }
-    
-    std::string result;
-    for (const auto& order : completed_orders_info){
-        if (order.size() >= 12){
-            result += fmt::format(
-                "{} {} {} {} {} {} {} {} {} {},",
-                two_times_to_string(std::stoll(order[0]), std::stoll(order[1])),
-                order[2],
-                order[3],
-                order[4],
-                order[5],
-                order[6],
-                order[7],
-                order[8],
-                order[9],
-                two_times_to_string(std::stoll(order[10]), std::stoll(order[11]))
-            );
+
+    int rows = Database.execute_SQL_query_rows_view(query, [&renderer, &cursor](sqlite3_stmt* stmt){
+        renderer.append_row(stmt);
+        cursor.order_time_date = sqlite3_column_int64(stmt, 0);
+        cursor.order_time_daily = sqlite3_column_int64(stmt, 1);
+        cursor.order_id = sqlite3_column_int64(stmt, 12);
+    });
+    cursor.done = rows < page_size;
+    return rows;
+}
+
+// send the completed orders one page per message through a reused buffer, an empty message ends the history
+// the memory used stays the one of a page, whatever the length of the history
+void Client::send_completed_orders(int sock, std::mutex& send_mtx, const int& page_size) const
+{
+    Order_List_Renderer renderer;
+    Order_History_Cursor cursor;
+    while (!cursor.done){
+        renderer.clear(); // keeps its capacity for the next page
+        if (get_completed_orders_page(renderer, cursor, page_size) > 0){
+            send_full_string(sock, renderer.view(), send_mtx);
         }
     }
-    if (!result.empty()){
-        result.pop_back(); // remove trailing comma
-    }
-    return result;
+    send_full_string(sock, "", send_mtx);
 }
 
-// get the portfolio info as a string : value balance,action_name_1 quantity1 last_price1,action_name_2 quantity2 last_price2,...
-std::string Client::get_portfolio_info() const
+// rendering of the cached views
+std::string Client::render_pending_orders_info() const
 {
     std::string query = fmt::format(
-        R"(SELECT a.name, cp.quantity, p.price, p.date_time, p.daily_time
-            FROM client_portfolio cp 
-            JOIN actions a ON cp.action_id = a.action_id 
-            LEFT JOIN prices p ON cp.action_id = p.action_id
-            WHERE cp.client_id = {} 
-            AND (p.date_time, p.daily_time) = (
-                SELECT p2.date_time, p2.daily_time FROM prices p2 
-                WHERE p2.action_id = cp.action_id 
-                AND p2.date_time = (SELECT MAX(p3.date_time) FROM prices p3 WHERE p3.action_id = p2.action_id) 
-                AND p2.daily_time = (SELECT MAX(p3.daily_time) FROM prices p3 WHERE p3.action_id = p2.action_id AND p3.date_time = p2.date_time)
-            ) ORDER BY a.action_id ASC)",
+        R"(SELECT {}
+          FROM orders o JOIN actions a ON o.action_id = a.action_id JOIN clients c ON o.client_id = c.client_id
+          WHERE o.client_id = {} AND o.order_status = 'PENDING')",
+        ORDER_LIST_COLUMNS,
         get_id()
     );
-    std::vector<std::vector<std::string>> portfolio_info = Database.execute_SQL_query_vec_strings(query);
-    
-    // check if we have enough data before accessing elements
-    if (portfolio_info.empty()){
-        // return the balance if no data is found
+    Order_List_Renderer renderer;
+    renderer.render(Database, query);
+    return renderer.to_string();
+}
+
+// valued from the account and the cached latest prices : no SQL once the prices and names are cached
+std::string Client::render_portfolio_info() const
+{
+    std::vector<Holding> holdings = Client_Account->get_holdings();
+    // return the balance if there is nothing to value
+    if (holdings.empty()){
         std::string result = fmt::format(
             "0.0 {},", 
             get_balance()
@@ -408,20 +313,23 @@ std::string Client::get_portfolio_info() const
         "{},", 
         get_balance()
     ); // add balance first and portfolio value will be added later
-    // iterate over the portfolio info to calculate value and format the output
-    for (const auto& row : portfolio_info){
-        if (row.size() >= 5){
-            int quantity = std::stoi(row[1]);
-            double price = std::stod(row[2]);
-            portfolio_value += quantity * price;
-            result += fmt::format(
-                "{} {} {} {},", 
-                row[0], // action name
-                quantity, 
-                price, 
-                two_times_to_string(std::stoll(row[4]), std::stoll(row[3]))
-            );
+    // iterate over the holdings to calculate value and format the output
+    for (const Holding& holding : holdings){
+        std::optional<Price_Point> latest_price = Database.get_latest_price(holding.action_id);
+        if (!latest_price){
+            continue; // an action without price can not be valued
         }
+        portfolio_value += holding.quantity * latest_price->price;
+        result += fmt::format(
+            "{} {} {} {} {} {} {},", 
+            Database.get_action_name(holding.action_id),
+            holding.quantity, 
+            latest_price->price, 
+            two_times_to_string(latest_price->date_time, latest_price->daily_time),
+            holding.average_cost,
+            holding.quantity * (latest_price->price - holding.average_cost), // unrealized P&L
+            holding.realized_pnl
+        );
     }
     // remove the trailing comma
     if (!result.empty()){
@@ -8,6 +8,21 @@
 
 #include "order.hpp"
 #include "action.hpp"
+#include "account.hpp"
+#include "order_list_renderer.hpp"
+
+
+#define ORDER_HISTORY_PAGE_SIZE 200 // default number of completed orders read and sent at once
+
+
+// position in the completed orders of a client, in (order time, order id) order : the last order of the previous page
+struct Order_History_Cursor
+{
+    ID order_time_date = -1;
+    ID order_time_daily = -1;
+    ID order_id = -1;
+    bool done = false; // the last page has been read
+};
 
 
 class Client
@@ -15,7 +30,12 @@ class Client
 private:
     ID Id; // define the client id
     Database_Manager& Database; // reference to the database manager for queries
-    
+    std::shared_ptr<Account> Client_Account; // in-memory balance and holdings, shared with the other handles of the client
+
+    // rendering of the cached views, called by the view cache when a view changed
+    std::string render_pending_orders_info() const;
+    std::string render_portfolio_info() const;
+
 public:
     // constructors
     Client(const ID& id, Database_Manager& database); // simple init
@@ -25,12 +45,16 @@ public:
     double get_balance() const;
 
     bool is_action_in_portfolio(const ID& action_id) const; // check if an action is in the portfolio
+    bool is_password_correct(const std::string& encrypted_password) const; // compare an encrypted password with the stored one without copying the blob
 
     // balance management:
     void deposit(const double& amount); // deposit funds into the account
     void withdraw(const double& amount); // withdraw funds from the account
     bool can_afford(const int& quantity, const double& price, const ID& action_id) const; // returns True if the amount can be withdrawn
 
+    // pre-trade risk:
+    Risk_Check check_order_risk(const Order_Type& order_type, const int& quantity, const ID& action_id, const double& price) const; // check a new order against the client's risk limits, before can_afford / has_shares
+
     // completed orders management:
     void add_completed_order(const ID& order_id, const ID& order_time_date, const ID& order_time_daily, const Order_Type& order_type, const int& quantity, const ID& action_id, const Order_Trigger& trigger_type, const double& price, const double& trigger_price_lower, const double& trigger_price_upper, const ID& expiration_time_date, const ID& expiration_time_daily); // add an order to the client's list of completed orders
 
@@ -42,12 +66,14 @@ public:
     void add_action(const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time); // add a quantity for a specific action and update its price if necessary
     void remove_action(const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time); // remove a quantity for a specific action and update its price if necessary
     bool has_shares(const ID& action_id, const int& quantity) const; // returns True if the action can be removed
-    void update_portfolio(const Order_Type& order_type, const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time); // update the portfolio with a new action (modify the client balance also)
+    void update_portfolio(const Order_Type& order_type, const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time, const ID& order_id = -1); // update the portfolio with a fill of a pending order (-1 : none), modify the client balance also
 
     // strings representation methods 
     std::string get_completed_orders_info() const; // get the completed orders info as a string : order_time_date order_time_daily client_name order_type quantity action_name trigger_type price trigger_price_lower trigger_price_upper expiration_time_date expiration_time_daily,...
+    int get_completed_orders_page(Order_List_Renderer& renderer, Order_History_Cursor& cursor, const int& page_size = ORDER_HISTORY_PAGE_SIZE) const; // append the next page of completed orders to the renderer (same format) and move the cursor, returns the number of orders
+    void send_completed_orders(int sock, std::mutex& send_mtx, const int& page_size = ORDER_HISTORY_PAGE_SIZE) const; // answer of DISPLAY_COMPLETED_ORDERS : one message per page of at most page_size orders (same format, oldest first), then an empty message that ends the history
     std::string get_pending_orders_info() const; // get the pending orders info as a string : order_time_date order_time_daily client_name order_type quantity action_name trigger_type price trigger_price_lower trigger_price_upper expiration_time_date expiration_time_daily,...
-    std::string get_portfolio_info() const; // get the portfolio info as a string : value balance,action_name_1 quantity1 last_price1,action_name_2 quantity2 last_price2,...
+    std::string get_portfolio_info() const; // get the portfolio info as a string : value balance,action_name_1 quantity1 last_price1 last_time1 average_cost1 unrealized_pnl1 realized_pnl1,...
 };
 
 
@@ -1,18 +1,100 @@
 #include "database_management.hpp"
 
 
+#include "account.hpp"
+
+
+// SQL queries to create the tables that can be split across shard files (shared between the main file and the shards)
+static const std::string create_prices_table = R"(
+    CREATE TABLE IF NOT EXISTS prices (
+        price_id INTEGER PRIMARY KEY,
+        action_id INTEGER NOT NULL,
+        price REAL NOT NULL,
+        date_time INTEGER NOT NULL,
+        daily_time INTEGER NOT NULL,
+        volume INTEGER NOT NULL DEFAULT 0,         -- quantity traded in the tick
+        trade_count INTEGER NOT NULL DEFAULT 0,    -- number of trades in the tick
+        FOREIGN KEY (action_id) REFERENCES actions(action_id)
+    );
+)";
+static const std::string create_orders_table = R"(
+    CREATE TABLE IF NOT EXISTS orders (
+        order_id INTEGER PRIMARY KEY,
+        order_status TEXT NOT NULL,                -- PENDING or COMPLETED
+        order_time_date INTEGER NOT NULL,
+        order_time_daily INTEGER NOT NULL,
+        client_id INTEGER NOT NULL,
+        order_type TEXT NOT NULL,                  -- BUY or SELL
+        quantity INTEGER NOT NULL,
+        action_id INTEGER NOT NULL,
+        trigger_type TEXT NOT NULL,                -- MARKET or LIMIT or STOP or LIMIT_STOP
+        price REAL NOT NULL,                       -- depends on the trigger type
+        trigger_price_lower REAL NOT NULL,         -- depends on the trigger type
+        trigger_price_upper REAL NOT NULL,         -- depends on the trigger type
+        expiration_time_date INTEGER NOT NULL,     -- UINT16_MAX=max_number if no expiration 
+        expiration_time_daily INTEGER NOT NULL,    -- UINT16_MAX=max_number if no expiration
+        FOREIGN KEY (client_id) REFERENCES clients(client_id),
+        FOREIGN KEY (action_id) REFERENCES actions(action_id)
+    );
+)";
+// keyset pagination of the order history : a page is a range scan of this index
+static const std::string create_orders_history_index = R"(
+    CREATE INDEX IF NOT EXISTS orders_history ON orders (client_id, order_status, order_time_date, order_time_daily, order_id);
+)";
+#define BUSY_TIMEOUT_MS 5000 // how long a connection waits for another writer of the same file before giving up
+
+
+// converting a string to a Database_Profile enum
+Database_Profile string_to_database_profile(const std::string& profile_str)
+{
+    static const std::unordered_map<std::string, Database_Profile> profile_map = {
+        {"default", Database_Profile::SQLITE_DEFAULT},
+        {"durable", Database_Profile::DURABLE},
+        {"balanced", Database_Profile::BALANCED},
+        {"simulation", Database_Profile::SIMULATION}
+    };
+
+    auto it = profile_map.find(profile_str);
+    return (it != profile_map.end()) ? it->second : Database_Profile::SQLITE_DEFAULT; // default value, error case
+}
+
+// converting a Database_Profile enum to a string
+std::string database_profile_to_string(const Database_Profile& profile)
+{
+    static const std::unordered_map<Database_Profile, std::string> profile_map = {
+        {Database_Profile::SQLITE_DEFAULT, "default"},
+        {Database_Profile::DURABLE, "durable"},
+        {Database_Profile::BALANCED, "balanced"},
+        {Database_Profile::SIMULATION, "simulation"}
+    };
+
+    auto it = profile_map.find(profile);
+    return (it != profile_map.end()) ? it->second : "default"; // default value, error case
+}
+
+
 // constructor
-Database_Manager::Database_Manager(const std::string& database_name)
+Database_Manager::Database_Manager(const std::string& database_name, const Database_Profile& profile) : Database_Name(database_name), Profile(profile)
 {
     if (sqlite3_open(database_name.c_str(), &Database) != SQLITE_OK){
         std::cerr << "Error opening database: " << sqlite3_errmsg(Database) << std::endl;
         throw std::runtime_error("Error opening database");
     }
+    sqlite3_busy_timeout(Database, BUSY_TIMEOUT_MS);
+    apply_profile_on(Database, Profile);
 }
 
 // destructor
 void Database_Manager::close_database()
 {
+    if (is_price_aggregation_enabled()){
+        flush_price_ticks();
+    }
+    for (sqlite3* shard : Shards){
+        sqlite3_close(shard);
+    }
+    Shards.clear();
+    Shard_Mutexes.clear();
     sqlite3_close(Database);
 }
 
@@ -23,21 +105,810 @@ sqlite3* Database_Manager::get_database() const
     return Database;
 }
 
+Database_Profile Database_Manager::get_profile() const
+{
+    return Profile;
+}
+
+
+// tuning
+// set the PRAGMAs of a profile on a connection
+void Database_Manager::apply_profile_on(sqlite3* database, const Database_Profile& profile)
+{
+    switch (profile){
+        case Database_Profile::DURABLE:
+            // page_size first : it is only taken into account before the file is created and cannot change once in WAL mode
+            execute_SQL_on(database, "PRAGMA page_size = 4096;");
+            execute_SQL_on(database, "PRAGMA journal_mode = WAL;");
+            execute_SQL_on(database, "PRAGMA synchronous = FULL;");
+            execute_SQL_on(database, "PRAGMA cache_size = -16000;"); // negative value in KiB : 16 MB
+            execute_SQL_on(database, "PRAGMA mmap_size = 0;");
+            execute_SQL_on(database, "PRAGMA temp_store = DEFAULT;");
+            break;
+        case Database_Profile::BALANCED:
+            execute_SQL_on(database, "PRAGMA page_size = 4096;");
+            execute_SQL_on(database, "PRAGMA journal_mode = WAL;");
+            execute_SQL_on(database, "PRAGMA synchronous = NORMAL;");
+            execute_SQL_on(database, "PRAGMA cache_size = -64000;"); // 64 MB
+            execute_SQL_on(database, "PRAGMA mmap_size = 268435456;"); // 256 MB
+            execute_SQL_on(database, "PRAGMA temp_store = MEMORY;");
+            break;
+        case Database_Profile::SIMULATION:
+            execute_SQL_on(database, "PRAGMA page_size = 8192;");
+            execute_SQL_on(database, "PRAGMA journal_mode = MEMORY;");
+            execute_SQL_on(database, "PRAGMA synchronous = OFF;");
+            execute_SQL_on(database, "PRAGMA cache_size = -256000;"); // 256 MB
+            execute_SQL_on(database, "PRAGMA mmap_size = 1073741824;"); // 1 GB
+            execute_SQL_on(database, "PRAGMA temp_store = MEMORY;");
+            break;
+        default:
+            // SQLite's own defaults, set explicitly : going back from another profile must undo every PRAGMA of it
+            execute_SQL_on(database, "PRAGMA page_size = 4096;");
+            execute_SQL_on(database, "PRAGMA journal_mode = DELETE;");
+            execute_SQL_on(database, "PRAGMA synchronous = FULL;");
+            execute_SQL_on(database, "PRAGMA cache_size = -2000;"); // 2 MB
+            execute_SQL_on(database, "PRAGMA mmap_size = 0;");
+            execute_SQL_on(database, "PRAGMA temp_store = DEFAULT;");
+            break;
+    }
+}
+
+// set journal_mode, synchronous, cache_size, mmap_size, temp_store and page_size together
+void Database_Manager::apply_profile(const Database_Profile& profile)
+{
+    Profile = profile;
+    apply_profile_on(Database, Profile);
+    for (sqlite3* shard : Shards){
+        apply_profile_on(shard, Profile);
+    }
+}
+
+
+// sharding mode
+// path of the shard file : <database_name>_shard_<index>.db
+std::string Database_Manager::get_shard_name(const int& shard_index) const
+{
+    std::filesystem::path path(Database_Name);
+    std::filesystem::path shard_path = path.parent_path() / fmt::format("{}_shard_{}{}", path.stem().string(), shard_index, path.extension().string());
+    return shard_path.string();
+}
+
+// create the "prices" and "orders" tables in a shard file
+void Database_Manager::create_sharded_tables(sqlite3* database)
+{
+    execute_SQL_on(database, create_prices_table);
+    add_column_if_missing(database, "prices", "volume", "INTEGER NOT NULL DEFAULT 0");
+    add_column_if_missing(database, "prices", "trade_count", "INTEGER NOT NULL DEFAULT 0");
+    execute_SQL_on(database, create_orders_table);
+    execute_SQL_on(database, create_orders_history_index);
+}
+
+// expose the shards as "prices" and "orders" on the main connection through UNION ALL views
+// temporary views are looked up before the main schema, so every existing read query keeps working unchanged (the rows left in the main file are hidden)
+void Database_Manager::create_sharded_views()
+{
+    std::string prices_union;
+    std::string orders_union;
+    for (size_t i = 0; i < Shards.size(); ++i){
+        if (i > 0){
+            prices_union += " UNION ALL ";
+            orders_union += " UNION ALL ";
+        }
+        prices_union += fmt::format("SELECT * FROM shard_{}.prices", i);
+        orders_union += fmt::format("SELECT * FROM shard_{}.orders", i);
+    }
+    execute_SQL("DROP VIEW IF EXISTS temp.prices;");
+    execute_SQL("DROP VIEW IF EXISTS temp.orders;");
+    execute_SQL(fmt::format("CREATE TEMP VIEW prices AS {};", prices_union));
+    execute_SQL(fmt::format("CREATE TEMP VIEW orders AS {};", orders_union));
+}
+
+// attach a shard file to the main connection as shard_<index>
+// the path is bound, not formatted in the statement : a quote in the database name cannot break (or inject into) the SQL
+void Database_Manager::attach_shard(const std::string& shard_name, const int& shard_index)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    std::string sql = fmt::format("ATTACH DATABASE ? AS shard_{};", shard_index);
+    sqlite3_stmt* stmt;
+    int result = sqlite3_prepare_v2(Database, sql.c_str(), -1, &stmt, nullptr);
+    if (result == SQLITE_OK){
+        sqlite3_bind_text(stmt, 1, shard_name.c_str(), -1, SQLITE_TRANSIENT);
+        result = sqlite3_step(stmt);
+    }
+    sqlite3_finalize(stmt);
+    if (result != SQLITE_DONE){
+        std::cerr << "Error attaching shard: " << sqlite3_errmsg(Database) << std::endl;
+        throw std::runtime_error("Error attaching shard");
+    }
+}
+
+// open (or create) the shard files and attach them to the main connection
+void Database_Manager::enable_sharding(const int& shard_count)
+{
+    if (shard_count < 1 || shard_count > MAX_SHARDS){
+        throw std::invalid_argument("Shard count must be between 1 and MAX_SHARDS");
+    }
+    if (is_sharded()){
+        throw std::runtime_error("Sharding mode already enabled");
+    }
+
+    for (int i = 0; i < shard_count; ++i){
+        std::string shard_name = get_shard_name(i);
+        sqlite3* shard = nullptr;
+        if (sqlite3_open(shard_name.c_str(), &shard) != SQLITE_OK){
+            std::cerr << "Error opening shard: " << sqlite3_errmsg(shard) << std::endl;
+            sqlite3_close(shard);
+            throw std::runtime_error("Error opening shard");
+        }
+        sqlite3_busy_timeout(shard, BUSY_TIMEOUT_MS);
+        apply_profile_on(shard, Profile);
+        if (is_change_capture_enabled()){
+            register_change_hooks(shard);
+        }
+        create_sharded_tables(shard);
+        Shards.push_back(shard);
+        Shard_Mutexes.push_back(std::make_unique<std::recursive_mutex>());
+        attach_shard(shard_name, i);
+    }
+    create_sharded_views();
+}
+
+bool Database_Manager::is_sharded() const
+{
+    return !Shards.empty();
+}
+
+// shard owning the rows of an action : action ids are random 32-bit numbers, so equal ranges give balanced shards
+int Database_Manager::get_shard_index(const ID& action_id) const
+{
+    if (!is_sharded() || action_id < 0){
+        return 0;
+    }
+    ID shard_index = (action_id * static_cast<ID>(Shards.size())) >> 32;
+    return static_cast<int>(std::min<ID>(shard_index, Shards.size() - 1));
+}
+
+// writer connection of the shard owning the action (the main one if not sharded)
+sqlite3* Database_Manager::get_shard_database(const ID& action_id) const
+{
+    if (!is_sharded()){
+        return Database;
+    }
+    return Shards[get_shard_index(action_id)];
+}
+
+// modify the "prices" or "orders" rows of a given action
+void Database_Manager::execute_SQL_routed(const ID& action_id, const std::string& sql)
+{
+    execute_SQL_on(get_shard_database(action_id), sql);
+}
+
+// modify the "prices" or "orders" rows when the action is not known
+void Database_Manager::execute_SQL_all_shards(const std::string& sql)
+{
+    if (!is_sharded()){
+        execute_SQL_on(Database, sql);
+        return;
+    }
+    for (sqlite3* shard : Shards){
+        execute_SQL_on(shard, sql);
+    }
+}
+
+
+// change-data-capture
+// row changed by a statement, kept until its transaction commits
+struct Pending_Change
+{
+    sqlite3* database; // connection that made the change
+    std::string schema; // "main" or an attached database
+    uint64_t sequence; // order of the change on its thread, a savepoint rolled back to drops the changes made after it
+    bool resolved; // the values of the row were read
+    bool found; // the row still existed when it was read (always false for a DELETE)
+    Change_Event event;
+};
+// savepoint open on a connection, and the sequence of the first change made after it
+struct Savepoint_Mark
+{
+    sqlite3* database;
+    std::string name;
+    uint64_t sequence;
+};
+// the hooks run on the thread executing the statement, so each thread keeps its own uncommitted changes
+static thread_local std::vector<Pending_Change> pending_changes;
+static thread_local std::vector<Savepoint_Mark> savepoint_marks;
+static thread_local uint64_t change_sequence = 0;
+
+// sqlite3_update_hook callback : only remember the row, the values are read once the statement has finished
+static void on_row_change(void* user_data, int operation, const char* schema, const char* table, sqlite3_int64 row_id)
+{
+    static const std::unordered_map<std::string, Change_Table> tracked_tables = {
+        {"orders", Change_Table::ORDERS},
+        {"prices", Change_Table::PRICES},
+        {"client_portfolio", Change_Table::CLIENT_PORTFOLIO},
+        {"clients", Change_Table::CLIENTS}
+    };
+    auto it = tracked_tables.find(table);
+    if (it == tracked_tables.end()){
+        return;
+    }
+    Change_Operation change_operation = Change_Operation::UPDATE;
+    if (operation == SQLITE_INSERT){
+        change_operation = Change_Operation::INSERT;
+    }
+    else if (operation == SQLITE_DELETE){
+        change_operation = Change_Operation::DELETE;
+    }
+    bool deleted = change_operation == Change_Operation::DELETE; // the row is gone, only its key is known
+    pending_changes.push_back({static_cast<sqlite3*>(user_data), schema, change_sequence++, deleted, false, Change_Event{it->second, change_operation, row_id}});
+}
+
+// sqlite3_rollback_hook callback : the changes of the connection never happened
+static void on_rollback(void* user_data)
+{
+    sqlite3* database = static_cast<sqlite3*>(user_data);
+    std::erase_if(pending_changes, [database](const Pending_Change& change){ return change.database == database; });
+    std::erase_if(savepoint_marks, [database](const Savepoint_Mark& mark){ return mark.database == database; });
+}
+
+// capture the changes made through a connection
+void Database_Manager::register_change_hooks(sqlite3* database)
+{
+    sqlite3_update_hook(database, on_row_change, database);
+    sqlite3_rollback_hook(database, on_rollback, database);
+}
+
+// read the values of the rows changed through a connection since the last reading (the write mutex of the connection must be held)
+// called after each statement, and before the next one in case it commits : inside a transaction, no other writer can change the rows meanwhile,
+// so each change keeps the state its own statements left
+void Database_Manager::resolve_pending_changes(sqlite3* database)
+{
+    for (Pending_Change& change : pending_changes){
+        if (change.database != database || change.resolved){
+            continue;
+        }
+        change.resolved = true;
+
+        std::string query;
+        switch (change.event.table){
+            case Change_Table::ORDERS:
+                query = fmt::format("SELECT client_id, action_id, quantity, price, order_time_date, order_time_daily, order_status = 'PENDING' FROM \"{}\".orders WHERE rowid = ?", change.schema);
+                break;
+            case Change_Table::PRICES:
+                query = fmt::format("SELECT action_id, price, date_time, daily_time FROM \"{}\".prices WHERE rowid = ?", change.schema);
+                break;
+            case Change_Table::CLIENT_PORTFOLIO:
+                query = fmt::format("SELECT client_id, action_id, quantity FROM \"{}\".client_portfolio WHERE rowid = ?", change.schema);
+                break;
+            case Change_Table::CLIENTS:
+                query = fmt::format("SELECT client_id, balance FROM \"{}\".clients WHERE rowid = ?", change.schema);
+                break;
+        }
+
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(database, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK){
+            sqlite3_bind_int64(stmt, 1, change.event.key);
+            if (sqlite3_step(stmt) == SQLITE_ROW){
+                change.found = true;
+                Change_Event& event = change.event;
+                switch (event.table){
+                    case Change_Table::ORDERS:
+                        event.client_id = sqlite3_column_int64(stmt, 0);
+                        event.action_id = sqlite3_column_int64(stmt, 1);
+                        event.quantity = sqlite3_column_int(stmt, 2);
+                        event.price = sqlite3_column_double(stmt, 3);
+                        event.date_time = sqlite3_column_int64(stmt, 4);
+                        event.daily_time = sqlite3_column_int64(stmt, 5);
+                        event.is_pending = sqlite3_column_int(stmt, 6) != 0;
+                        break;
+                    case Change_Table::PRICES:
+                        event.action_id = sqlite3_column_int64(stmt, 0);
+                        event.price = sqlite3_column_double(stmt, 1);
+                        event.date_time = sqlite3_column_int64(stmt, 2);
+                        event.daily_time = sqlite3_column_int64(stmt, 3);
+                        break;
+                    case Change_Table::CLIENT_PORTFOLIO:
+                        event.client_id = sqlite3_column_int64(stmt, 0);
+                        event.action_id = sqlite3_column_int64(stmt, 1);
+                        event.quantity = sqlite3_column_int(stmt, 2);
+                        break;
+                    case Change_Table::CLIENTS:
+                        event.client_id = sqlite3_column_int64(stmt, 0);
+                        event.balance = sqlite3_column_int64(stmt, 1);
+                        break;
+                }
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+}
+
+// publish the changes of a committed connection, one event per row with its last values
+// a row inserted then changed is an INSERT, a row changed then deleted a DELETE, a row inserted then deleted is not published
+void Database_Manager::publish_pending_changes(sqlite3* database)
+{
+    std::vector<Pending_Change> committed;
+    std::erase_if(pending_changes, [&](Pending_Change& change){
+        if (change.database != database){
+            return false;
+        }
+        committed.push_back(std::move(change));
+        return true;
+    });
+    std::erase_if(savepoint_marks, [database](const Savepoint_Mark& mark){ return mark.database == database; });
+
+    // first and last change of each row, the event goes out at the place of the last one
+    struct Row_Changes
+    {
+        size_t first;
+        size_t last;
+    };
+    std::map<std::tuple<std::string, Change_Table, ID>, Row_Changes> rows;
+    for (size_t i = 0; i < committed.size(); ++i){
+        auto [it, inserted] = rows.try_emplace({committed[i].schema, committed[i].event.table, committed[i].event.key}, Row_Changes{i, i});
+        it->second.last = i;
+    }
+    std::vector<bool> is_last(committed.size(), false);
+    std::vector<Change_Operation> first_operations(committed.size());
+    for (const auto& [row, changes] : rows){
+        is_last[changes.last] = true;
+        first_operations[changes.last] = committed[changes.first].event.operation;
+    }
+
+    for (size_t i = 0; i < committed.size(); ++i){
+        if (!is_last[i]){
+            continue;
+        }
+        Change_Event event = committed[i].event;
+        bool was_inserted = first_operations[i] == Change_Operation::INSERT;
+        if (event.operation == Change_Operation::DELETE){
+            if (!was_inserted){
+                Feed->publish(event);
+            }
+            continue;
+        }
+        if (was_inserted){
+            event.operation = Change_Operation::INSERT;
+        }
+        if (committed[i].found){ // a row deleted by a statement the hook did not see (a trigger) is not published
+            Feed->publish(event);
+        }
+    }
+}
+
+// start capturing the changes (call it before sharing the manager between threads)
+void Database_Manager::enable_change_capture(const size_t& capacity)
+{
+    if (is_change_capture_enabled()){
+        return;
+    }
+    Feed = std::make_unique<Change_Feed>(capacity);
+    register_change_hooks(Database);
+    for (sqlite3* shard : Shards){
+        register_change_hooks(shard);
+    }
+}
+
+bool Database_Manager::is_change_capture_enabled() const
+{
+    return Feed != nullptr;
+}
+
+// read every change committed from now on
+Change_Subscriber Database_Manager::subscribe_changes() const
+{
+    if (!is_change_capture_enabled()){
+        throw std::runtime_error("Change capture is not enabled");
+    }
+    return Feed->subscribe();
+}
+
+
+// price points
+// collapse the fills of an action within a time bucket into one row, written in batches
+void Database_Manager::enable_price_aggregation(const ID& bucket_ms, const size_t& batch_size)
+{
+    if (is_price_aggregation_enabled()){
+        flush_price_ticks();
+    }
+    Aggregator = std::make_unique<Price_Aggregator>(bucket_ms, batch_size);
+}
+
+bool Database_Manager::is_price_aggregation_enabled() const
+{
+    return Aggregator != nullptr;
+}
+
+// record a fill in the "prices" table (or in the current tick)
+void Database_Manager::record_price(const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time)
+{
+    // keep the cached latest price up to date (a fill older than the cached one does not move it)
+    {
+        std::unique_lock<std::shared_mutex> lock(Market_Mutex);
+        auto [it, inserted] = Latest_Prices.try_emplace(action_id, Price_Point{price, date_time, daily_time});
+        if (!inserted && std::tie(date_time, daily_time) >= std::tie(it->second.date_time, it->second.daily_time)){
+            it->second = {price, date_time, daily_time};
+            inserted = true;
+        }
+        if (inserted){
+            Price_Versions[action_id] = ++Market_Version;
+        }
+    }
+
+    if (is_price_aggregation_enabled()){
+        if (Aggregator->add_fill(action_id, quantity, price, daily_time, date_time)){
+            write_price_ticks(Aggregator->take_closed_ticks());
+        }
+        return;
+    }
+
+    // check if the price and time already exist in the prices table (the other leg of the same trade)
+    std::string check_query = fmt::format(
+        "SELECT 1 FROM prices WHERE action_id = {} AND price = {} AND daily_time = {} AND date_time = {} LIMIT 1",
+        action_id, 
+        price, 
+        daily_time, 
+        date_time
+    );
+    std::vector<std::vector<std::string>> existing_price = execute_SQL_query_vec_strings(check_query);
+    // if no matching price-time exists, insert the new price-time
+    if (existing_price.empty()){
+        std::string query = fmt::format(
+            "INSERT INTO prices (action_id, price, daily_time, date_time, volume, trade_count) VALUES ({}, {}, {}, {}, {}, {})",
+            action_id, 
+            price, 
+            daily_time, 
+            date_time,
+            quantity,
+            (quantity > 0) ? 1 : 0
+        );
+        execute_SQL_routed(action_id, query);
+    }
+    // otherwise the buying leg adds its quantity to the existing row
+    else if (quantity > 0){
+        std::string query = fmt::format(
+            "UPDATE prices SET volume = volume + {}, trade_count = trade_count + 1 WHERE action_id = {} AND price = {} AND daily_time = {} AND date_time = {}",
+            quantity,
+            action_id, 
+            price, 
+            daily_time, 
+            date_time
+        );
+        execute_SQL_routed(action_id, query);
+    }
+}
+
+// write every tick, including the ones of the current buckets
+void Database_Manager::flush_price_ticks()
+{
+    if (is_price_aggregation_enabled()){
+        write_price_ticks(Aggregator->take_all_ticks());
+    }
+}
+
+// insert the ticks in one transaction per shard
+void Database_Manager::write_price_ticks(const std::vector<Price_Tick>& ticks)
+{
+    if (ticks.empty()){
+        return;
+    }
+    std::unordered_map<sqlite3*, std::vector<const Price_Tick*>> ticks_by_shard;
+    for (const Price_Tick& tick : ticks){
+        ticks_by_shard[get_shard_database(tick.action_id)].push_back(&tick);
+    }
+
+    for (const auto& [database, shard_ticks] : ticks_by_shard){
+        std::lock_guard<std::recursive_mutex> lock(get_write_mutex(database));
+        execute_SQL_on(database, "BEGIN;");
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(database, "INSERT INTO prices (action_id, price, daily_time, date_time, volume, trade_count) VALUES (?, ?, ?, ?, ?, ?)", -1, &stmt, nullptr) == SQLITE_OK){
+            for (const Price_Tick* tick : shard_ticks){
+                sqlite3_bind_int64(stmt, 1, tick->action_id);
+                sqlite3_bind_double(stmt, 2, tick->price);
+                sqlite3_bind_int64(stmt, 3, tick->daily_time);
+                sqlite3_bind_int64(stmt, 4, tick->date_time);
+                sqlite3_bind_int(stmt, 5, tick->volume);
+                sqlite3_bind_int(stmt, 6, tick->trade_count);
+                if (sqlite3_step(stmt) != SQLITE_DONE){
+                    std::cerr << "Error writing price tick: " << sqlite3_errmsg(database) << std::endl;
+                }
+                sqlite3_reset(stmt);
+            }
+        }
+        else {
+            std::cerr << "Error preparing price tick insert: " << sqlite3_errmsg(database) << std::endl;
+        }
+        sqlite3_finalize(stmt);
+        execute_SQL_on(database, "COMMIT;");
+    }
+}
+
+
+// accounts
+// get (or load) the account of a client
+std::shared_ptr<Account> Database_Manager::get_account(const ID& client_id)
+{
+    std::lock_guard<std::mutex> lock(Accounts_Mutex);
+    auto it = Accounts.find(client_id);
+    if (it != Accounts.end()){
+        return it->second;
+    }
+    std::shared_ptr<Account> account = std::make_shared<Account>(client_id, *this);
+    account->set_risk_limits(Default_Risk_Limits);
+    Accounts.emplace(client_id, account);
+    return account;
+}
+
+// forget the loaded accounts, they are loaded again from the database on next use
+void Database_Manager::clear_accounts()
+{
+    std::lock_guard<std::mutex> lock(Accounts_Mutex);
+    Accounts.clear();
+}
+
+// limits of every account loaded from now on (Account::set_risk_limits for one client)
+void Database_Manager::set_default_risk_limits(const Risk_Limits& limits)
+{
+    std::lock_guard<std::mutex> lock(Accounts_Mutex);
+    Default_Risk_Limits = limits;
+}
+
+Risk_Limits Database_Manager::get_default_risk_limits()
+{
+    std::lock_guard<std::mutex> lock(Accounts_Mutex);
+    return Default_Risk_Limits;
+}
+
+// a write not made through the account changed a view of the client (nothing if the account is not loaded)
+void Database_Manager::invalidate_client_view(const ID& client_id, const Client_View& view)
+{
+    std::lock_guard<std::mutex> lock(Accounts_Mutex);
+    auto it = Accounts.find(client_id);
+    if (it != Accounts.end()){
+        it->second->get_views().invalidate(view);
+    }
+}
+
+
+// market cache
+// last price of an action (written or not), nullopt if it has none
+std::optional<Price_Point> Database_Manager::get_latest_price(const ID& action_id)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(Market_Mutex);
+        auto it = Latest_Prices.find(action_id);
+        if (it != Latest_Prices.end()){
+            return it->second;
+        }
+    }
+
+    // first use : the last written row (a fill recorded since then is already in the cache)
+    std::string query = fmt::format(
+        "SELECT price, date_time, daily_time FROM prices WHERE action_id = {} ORDER BY date_time DESC, daily_time DESC LIMIT 1",
+        action_id
+    );
+    std::vector<std::vector<std::string>> rows = execute_SQL_query_vec_strings(query);
+    if (rows.empty() || rows[0].size() < 3){
+        return std::nullopt;
+    }
+    Price_Point point = {std::stod(rows[0][0]), std::stoll(rows[0][1]), std::stoll(rows[0][2])};
+
+    std::unique_lock<std::shared_mutex> lock(Market_Mutex);
+    return Latest_Prices.emplace(action_id, point).first->second; // a fill recorded meanwhile wins
+}
+
+// name of an action, empty if it does not exist
+std::string Database_Manager::get_action_name(const ID& action_id)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(Market_Mutex);
+        auto it = Action_Names.find(action_id);
+        if (it != Action_Names.end()){
+            return it->second;
+        }
+    }
+    std::vector<std::string> names = execute_SQL_query_strings(fmt::format("SELECT name FROM actions WHERE action_id = {}", action_id));
+    if (names.empty()){
+        return "";
+    }
+    std::unique_lock<std::shared_mutex> lock(Market_Mutex);
+    return Action_Names.emplace(action_id, names[0]).first->second;
+}
+
+// forget the cached prices and names, they are loaded again on next use
+void Database_Manager::clear_market_cache()
+{
+    flush_price_ticks(); // the aggregated fills must be in the table to be found again
+    forget_market_cache();
+}
+
+// forget the cached prices and names without writing the pending ticks, for a reset that already rewrote the "prices" table
+void Database_Manager::forget_market_cache()
+{
+    std::unique_lock<std::shared_mutex> lock(Market_Mutex);
+    Latest_Prices.clear();
+    Action_Names.clear();
+    Price_Versions.clear();
+    Cleared_Version = ++Market_Version;
+}
+
+// version of the prices of some actions, changes whenever one of their latest prices changes
+// the versions come from one counter, so the latest stamp among the actions moves with any of them, and a fill on another action leaves it unchanged
+uint64_t Database_Manager::get_market_version(const std::vector<ID>& action_ids)
+{
+    std::shared_lock<std::shared_mutex> lock(Market_Mutex);
+    uint64_t version = Cleared_Version;
+    for (const ID& action_id : action_ids){
+        auto it = Price_Versions.find(action_id);
+        if (it != Price_Versions.end()){
+            version = std::max(version, it->second);
+        }
+    }
+    return version;
+}
+
+
+// declared type of a column, nullopt if the table has no such column
+std::optional<std::string> Database_Manager::get_column_type(sqlite3* database, const std::string& table, const std::string& column)
+{
+    std::lock_guard<std::recursive_mutex> lock(get_write_mutex(database));
+    sqlite3_stmt* stmt;
+    std::optional<std::string> type;
+    std::string query = fmt::format("PRAGMA table_info({})", table);
+
+    if (sqlite3_prepare_v2(database, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK){
+        while (!type && sqlite3_step(stmt) == SQLITE_ROW){
+            const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));  // second column is the column name
+            const char* declared = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));  // third one is its declared type
+            if (name && column == name){
+                type = declared ? declared : "";
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+    return type;
+}
+
+// upgrade a table created by an older version
+void Database_Manager::add_column_if_missing(sqlite3* database, const std::string& table, const std::string& column, const std::string& definition)
+{
+    if (!get_column_type(database, table, column)){
+        execute_SQL_on(database, fmt::format("ALTER TABLE {} ADD COLUMN {} {};", table, column, definition));
+    }
+}
+
+// upgrade a REAL amount column created by an older version to INTEGER money units
+// SQLite can not change the type of a column : a new column takes the converted amounts and then replaces the old one, the other columns and the keys are kept
+void Database_Manager::convert_column_to_money(sqlite3* database, const std::string& table, const std::string& column)
+{
+    std::lock_guard<std::recursive_mutex> lock(get_write_mutex(database));
+    if (get_column_type(database, table, column) != "REAL"){
+        return;
+    }
+    execute_SQL_on(database, fmt::format(R"(
+        BEGIN;
+        ALTER TABLE {0} ADD COLUMN {1}_money INTEGER NOT NULL DEFAULT 0;
+        UPDATE {0} SET {1}_money = CAST(ROUND({1} * {2}) AS INTEGER);
+        ALTER TABLE {0} DROP COLUMN {1};
+        ALTER TABLE {0} RENAME COLUMN {1}_money TO {1};
+        COMMIT;
+    )", table, column, MONEY_SCALE));
+    if (!sqlite3_get_autocommit(database)){
+        execute_SQL_on(database, "ROLLBACK;"); // a step failed, the table is left as it was
+    }
+}
+
 
 // functions to execute an SQL query
+// mutex owning a connection during a statement or a transaction
+std::recursive_mutex& Database_Manager::get_write_mutex(sqlite3* database)
+{
+    for (size_t i = 0; i < Shards.size(); ++i){
+        if (Shards[i] == database){
+            return *Shard_Mutexes[i];
+        }
+    }
+    return Write_Mutex;
+}
+
+// modify the given database connection
+void Database_Manager::execute_SQL_on(sqlite3* database, const std::string& sql)
+{
+    std::lock_guard<std::recursive_mutex> lock(get_write_mutex(database));
+    if (is_change_capture_enabled()){
+        resolve_pending_changes(database); // rows changed by the statements stepped directly, read before this one commits
+    }
+    char* error_message = nullptr;
+    if (sqlite3_exec(database, sql.c_str(), nullptr, nullptr, &error_message) != SQLITE_OK){
+        std::cerr << "Error executing SQL: " << error_message << std::endl;
+        sqlite3_free(error_message);
+    }
+    // the changes are only published once committed (at once in autocommit mode, at the COMMIT of an explicit transaction)
+    if (is_change_capture_enabled()){
+        resolve_pending_changes(database);
+        if (sqlite3_get_autocommit(database)){
+            publish_pending_changes(database);
+        }
+    }
+}
+
 // modify the database
 void Database_Manager::execute_SQL(const std::string& sql)
 {
+    execute_SQL_on(Database, sql);
+}
+
+// modify the database and return the number of changed rows (-1 on error), to check a guarded UPDATE
+int Database_Manager::execute_SQL_changes(const std::string& sql)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    if (is_change_capture_enabled()){
+        resolve_pending_changes(Database);
+    }
     char* error_message = nullptr;
     if (sqlite3_exec(Database, sql.c_str(), nullptr, nullptr, &error_message) != SQLITE_OK){
         std::cerr << "Error executing SQL: " << error_message << std::endl;
         sqlite3_free(error_message);
+        return -1;
+    }
+    int changes = sqlite3_changes(Database); // rows changed by the last statement of this connection, stable since we own it
+    if (is_change_capture_enabled()){
+        resolve_pending_changes(Database);
+        if (sqlite3_get_autocommit(Database)){
+            publish_pending_changes(Database);
+        }
+    }
+    return changes;
+}
+
+// savepoints of the main connection, inside a transaction : a part of it can be undone alone
+// open a savepoint
+void Database_Manager::savepoint(const std::string& name)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    execute_SQL(fmt::format("SAVEPOINT {};", name));
+    if (is_change_capture_enabled()){
+        savepoint_marks.push_back({Database, name, change_sequence});
+    }
+}
+
+// undo the changes made since the savepoint, it stays open
+// ROLLBACK TO does not call the rollback hook : the changes captured since the savepoint are dropped here
+void Database_Manager::rollback_to_savepoint(const std::string& name)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    if (is_change_capture_enabled()){
+        auto mark = std::find_if(savepoint_marks.rbegin(), savepoint_marks.rend(), [this, &name](const Savepoint_Mark& m){
+            return m.database == Database && m.name == name;
+        });
+        if (mark != savepoint_marks.rend()){
+            uint64_t sequence = mark->sequence;
+            std::erase_if(pending_changes, [this, sequence](const Pending_Change& change){ return change.database == Database && change.sequence >= sequence; });
+            savepoint_marks.erase(mark.base(), savepoint_marks.end()); // the savepoints opened after it are gone too
+        }
+    }
+    execute_SQL(fmt::format("ROLLBACK TO {};", name));
+}
+
+// keep the changes made since the savepoint and close it
+void Database_Manager::release_savepoint(const std::string& name)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    execute_SQL(fmt::format("RELEASE {};", name));
+    if (is_change_capture_enabled()){
+        auto mark = std::find_if(savepoint_marks.rbegin(), savepoint_marks.rend(), [this, &name](const Savepoint_Mark& m){
+            return m.database == Database && m.name == name;
+        });
+        if (mark != savepoint_marks.rend()){
+            savepoint_marks.erase(std::prev(mark.base()), savepoint_marks.end());
+        }
     }
 }
 
 // get an integer result from the database
 int Database_Manager::execute_SQL_query_int(const std::string& sql)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex); // wait for the transaction of another thread, its rows are not committed yet
     sqlite3_stmt* stmt;
     int result = -1; // default if no result
 
@@ -53,6 +924,7 @@ int Database_Manager::execute_SQL_query_int(const std::string& sql)
 // get a vector of integers from the database
 std::vector<int> Database_Manager::execute_SQL_query_ints(const std::string& query)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     std::vector<int> ints;
     sqlite3_stmt* stmt;
     
@@ -68,12 +940,13 @@ std::vector<int> Database_Manager::execute_SQL_query_ints(const std::string& que
 // get an ID result from the database
 ID Database_Manager::execute_SQL_query_ID(const std::string& sql)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     sqlite3_stmt* stmt;
     ID result = -1; // default if no result
 
     if (sqlite3_prepare_v2(Database, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
         if (sqlite3_step(stmt) == SQLITE_ROW) {
-            result = sqlite3_column_int(stmt, 0);  // get the first column value
+            result = sqlite3_column_int64(stmt, 0);  // get the first column value
         }
     }
     sqlite3_finalize(stmt);
@@ -83,6 +956,7 @@ ID Database_Manager::execute_SQL_query_ID(const std::string& sql)
 // get a vector of IDs from the database
 std::vector<ID> Database_Manager::execute_SQL_query_IDs(const std::string& query)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     std::vector<ID> ids;
     sqlite3_stmt* stmt;
     
@@ -140,6 +1014,7 @@ ID Database_Manager::get_new_message_id()
 // get a double result from the database
 double Database_Manager::execute_SQL_query_double(const std::string& sql)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     sqlite3_stmt* stmt;
     double result = -1.0; // default if no result
 
@@ -155,6 +1030,7 @@ double Database_Manager::execute_SQL_query_double(const std::string& sql)
 // get a vector of doubles from the database
 std::vector<double> Database_Manager::execute_SQL_query_doubles(const std::string& query)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     std::vector<double> doubles;
     sqlite3_stmt* stmt;
     
@@ -170,6 +1046,7 @@ std::vector<double> Database_Manager::execute_SQL_query_doubles(const std::strin
 // get a string result from the database
 std::string Database_Manager::execute_SQL_query_string(const std::string& sql)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     sqlite3_stmt* stmt;
     std::string result;
 
@@ -185,6 +1062,7 @@ std::string Database_Manager::execute_SQL_query_string(const std::string& sql)
 // get a vector of strings from the database
 std::vector<std::string> Database_Manager::execute_SQL_query_strings(const std::string& query)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     std::vector<std::string> strings;
     sqlite3_stmt* stmt;
     
@@ -200,6 +1078,7 @@ std::vector<std::string> Database_Manager::execute_SQL_query_strings(const std::
 // get a vector of vectors of strings from the database
 std::vector<std::vector<std::string>> Database_Manager::execute_SQL_query_vec_strings(const std::string& query)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     std::vector<std::vector<std::string>> results;
     sqlite3_stmt* stmt;
     
@@ -222,6 +1101,7 @@ std::vector<std::vector<std::string>> Database_Manager::execute_SQL_query_vec_st
 // get a blob result from the database
 std::vector<unsigned char> Database_Manager::execute_SQL_query_blob(const std::string& query)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     sqlite3_stmt* stmt;
     std::vector<unsigned char> result;
 
@@ -240,6 +1120,7 @@ std::vector<unsigned char> Database_Manager::execute_SQL_query_blob(const std::s
 // get a vector of blobs from the database
 std::vector<std::vector<unsigned char>> Database_Manager::execute_SQL_query_blobs(const std::string& query)
 {
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
     std::vector<std::vector<unsigned char>> blobs;
     sqlite3_stmt* stmt;
     
@@ -247,15 +1128,119 @@ std::vector<std::vector<unsigned char>> Database_Manager::execute_SQL_query_blob
         while (sqlite3_step(stmt) == SQLITE_ROW){
             const void* data = sqlite3_column_blob(stmt, 0);  // retrieve the first column as BLOB
             int length = sqlite3_column_bytes(stmt, 0);  // get the size of the BLOB
-            std::vector<unsigned char> blob(reinterpret_cast<const unsigned char*>(data), 
-                                            reinterpret_cast<const unsigned char*>(data) + length);  // convert BLOB to vector<unsigned char>
-            blobs.push_back(blob);
+            blobs.emplace_back(reinterpret_cast<const unsigned char*>(data), 
+                               reinterpret_cast<const unsigned char*>(data) + length);  // convert BLOB to vector<unsigned char> in place
         }
     }
     sqlite3_finalize(stmt);
     return blobs;
 }
 
+// read the first blob of the result without copying it, false if there is no row
+bool Database_Manager::execute_SQL_query_blob_view(const std::string& query, const std::function<void(std::span<const unsigned char>)>& reader)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    sqlite3_stmt* stmt;
+    bool found = false;
+
+    if (sqlite3_prepare_v2(Database, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK){
+        if (sqlite3_step(stmt) == SQLITE_ROW){
+            const unsigned char* data = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 0));  // valid until the next step or finalize
+            int length = sqlite3_column_bytes(stmt, 0);  // must be called after sqlite3_column_blob
+            reader(std::span<const unsigned char>(data, data ? length : 0));
+            found = true;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// read every blob of the result without copying them, returns the number of rows
+int Database_Manager::execute_SQL_query_blobs_view(const std::string& query, const std::function<void(std::span<const unsigned char>)>& reader)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    sqlite3_stmt* stmt;
+    int rows = 0;
+
+    if (sqlite3_prepare_v2(Database, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK){
+        while (sqlite3_step(stmt) == SQLITE_ROW){
+            const unsigned char* data = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 0));
+            int length = sqlite3_column_bytes(stmt, 0);
+            reader(std::span<const unsigned char>(data, data ? length : 0));
+            ++rows;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return rows;
+}
+
+// streamed rows
+// read every row of the result in place, returns the number of rows
+int Database_Manager::execute_SQL_query_rows_view(const std::string& query, const std::function<void(sqlite3_stmt*)>& reader)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    sqlite3_stmt* stmt;
+    int rows = 0;
+
+    if (sqlite3_prepare_v2(Database, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK){
+        while (sqlite3_step(stmt) == SQLITE_ROW){
+            reader(stmt);
+            ++rows;
+        }
+    }
+    else {
+        std::cerr << "Error preparing SQL: " << sqlite3_errmsg(Database) << std::endl;
+    }
+    sqlite3_finalize(stmt);
+    return rows;
+}
+
+// size in bytes of a blob, -1 if it cannot be opened
+int Database_Manager::get_blob_size(const std::string& table, const std::string& column, const ID& row_id)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    sqlite3_blob* blob;
+    int size = -1;
+
+    if (sqlite3_blob_open(Database, "main", table.c_str(), column.c_str(), row_id, 0, &blob) == SQLITE_OK){
+        size = sqlite3_blob_bytes(blob);
+    }
+    sqlite3_blob_close(blob);
+    return size;
+}
+
+// fill the destination with the blob bytes starting at offset
+bool Database_Manager::read_blob(const std::string& table, const std::string& column, const ID& row_id, std::span<unsigned char> destination, const int& offset)
+{
+    std::lock_guard<std::recursive_mutex> lock(Write_Mutex);
+    sqlite3_blob* blob;
+    bool success = false;
+
+    if (sqlite3_blob_open(Database, "main", table.c_str(), column.c_str(), row_id, 0, &blob) == SQLITE_OK){
+        if (offset >= 0 && offset + destination.size() <= static_cast<size_t>(sqlite3_blob_bytes(blob))){
+            success = sqlite3_blob_read(blob, destination.data(), destination.size(), offset) == SQLITE_OK;
+        }
+    }
+    sqlite3_blob_close(blob);
+    return success;
+}
+
+// load a key and IV pair of the "encryption_keys" table into AES_KEY_SIZE and AES_IV_SIZE buffers
+bool Database_Manager::load_encryption_keys(const ID& key_id, unsigned char* aes_key, unsigned char* aes_iv)
+{
+    // "id" is not an alias of the rowid (INT and not INTEGER), so we need to look the rowid up first
+    std::string query = fmt::format(
+        "SELECT rowid FROM encryption_keys WHERE id = {}",
+        key_id
+    );
+    ID row_id = execute_SQL_query_ID(query);
+    if (row_id == -1){
+        return false;
+    }
+    return read_blob("encryption_keys", "key", row_id, std::span<unsigned char>(aes_key, AES_KEY_SIZE)) 
+        && read_blob("encryption_keys", "iv", row_id, std::span<unsigned char>(aes_iv, AES_IV_SIZE));
+}
+
 
 // database management
 // function to create the tables in the database
@@ -271,52 +1256,35 @@ void Database_Manager::create_tables()
     )";
     execute_SQL(create_actions_table);
 
-    // SQL query to create the "prices" table
-    std::string create_prices_table = R"(
-        CREATE TABLE IF NOT EXISTS prices (
-            price_id INTEGER PRIMARY KEY,
-            action_id INTEGER NOT NULL,
-            price REAL NOT NULL,
-            date_time INTEGER NOT NULL,
-            daily_time INTEGER NOT NULL,
-            FOREIGN KEY (action_id) REFERENCES actions(action_id)
-        );
-    )";
-    execute_SQL(create_prices_table);
+    // SQL query to create the "prices" table (in the shard files if the sharding mode is on)
+    if (is_sharded()){
+        for (sqlite3* shard : Shards){
+            create_sharded_tables(shard);
+        }
+    }
+    else {
+        execute_SQL(create_prices_table);
+        add_column_if_missing(Database, "prices", "volume", "INTEGER NOT NULL DEFAULT 0");
+        add_column_if_missing(Database, "prices", "trade_count", "INTEGER NOT NULL DEFAULT 0");
+    }
 
-    // SQL query to create the "clients" table
+    // SQL query to create the "clients" table (balance in money units, see price.hpp)
     std::string create_clients_table = R"(
         CREATE TABLE IF NOT EXISTS clients (
             client_id INTEGER PRIMARY KEY,
             name TEXT NOT NULL,
             encrypted_password BLOB NOT NULL,
-            balance REAL NOT NULL
+            balance INTEGER NOT NULL
         );
     )";
     execute_SQL(create_clients_table);
+    convert_column_to_money(Database, "clients", "balance");
 
-    // SQL query to create the "orders" table
-    std::string create_orders_table = R"(
-        CREATE TABLE IF NOT EXISTS orders (
-            order_id INTEGER PRIMARY KEY,
-            order_status TEXT NOT NULL,                -- PENDING or COMPLETED
-            order_time_date INTEGER NOT NULL,
-            order_time_daily INTEGER NOT NULL,
-            client_id INTEGER NOT NULL,
-            order_type TEXT NOT NULL,                  -- BUY or SELL
-            quantity INTEGER NOT NULL,
-            action_id INTEGER NOT NULL,
-            trigger_type TEXT NOT NULL,                -- MARKET or LIMIT or STOP or LIMIT_STOP
-            price REAL NOT NULL,                       -- depends on the trigger type
-            trigger_price_lower REAL NOT NULL,         -- depends on the trigger type
-            trigger_price_upper REAL NOT NULL,         -- depends on the trigger type
-            expiration_time_date INTEGER NOT NULL,     -- UINT16_MAX=max_number if no expiration 
-            expiration_time_daily INTEGER NOT NULL,    -- UINT16_MAX=max_number if no expiration
-            FOREIGN KEY (client_id) REFERENCES clients(client_id),
-            FOREIGN KEY (action_id) REFERENCES actions(action_id)
-        );
-    )";
-    execute_SQL(create_orders_table);
+    // SQL query to create the "orders" table (already created with the prices in the shard files if the sharding mode is on)
+    if (!is_sharded()){
+        execute_SQL(create_orders_table);
+        execute_SQL(create_orders_history_index);
+    }
 
     // SQL query to create the "client_portfolio" table
     std::string create_client_portfolio_table = R"(
@@ -324,12 +1292,16 @@ void Database_Manager::create_tables()
             client_id INTEGER NOT NULL,
             action_id INTEGER NOT NULL,
             quantity INTEGER NOT NULL,
+            average_cost REAL NOT NULL DEFAULT 0,
+            realized_pnl REAL NOT NULL DEFAULT 0,
             PRIMARY KEY (client_id, action_id),
             FOREIGN KEY (client_id) REFERENCES clients(client_id),
             FOREIGN KEY (action_id) REFERENCES actions(action_id)
         );
     )";
     execute_SQL(create_client_portfolio_table);
+    add_column_if_missing(Database, "client_portfolio", "average_cost", "REAL NOT NULL DEFAULT 0");
+    add_column_if_missing(Database, "client_portfolio", "realized_pnl", "REAL NOT NULL DEFAULT 0");
 
     // SQL query to create the "messages" table (client_id = 0 for the server)
     std::string create_messages_table = R"(
@@ -360,11 +1332,15 @@ void Database_Manager::create_tables()
 // reset all the datas in the database to have a clear market
 void Database_Manager::reset_database()
 {
+    // the loaded accounts and the market cache describe the tables about to be dropped
+    clear_accounts();
+    clear_market_cache();
+
     // drop tables
     execute_SQL("DROP TABLE IF EXISTS actions;");
-    execute_SQL("DROP TABLE IF EXISTS prices;");
+    execute_SQL_all_shards("DROP TABLE IF EXISTS prices;");
     execute_SQL("DROP TABLE IF EXISTS clients;");
-    execute_SQL("DROP TABLE IF EXISTS orders;");
+    execute_SQL_all_shards("DROP TABLE IF EXISTS orders;");
     execute_SQL("DROP TABLE IF EXISTS client_portfolio;");
     execute_SQL("DROP TABLE IF EXISTS messages;");
     execute_SQL("DROP TABLE IF EXISTS encryption_keys;");
@@ -376,6 +1352,9 @@ void Database_Manager::reset_database()
 // reset the prices in the database to the actions of the market and the client's portfolio, to the last price and the given time
 void Database_Manager::reset_database_action_prices(const ID& reset_daily_time, const ID& reset_date_time)
 {
+    // the aggregated fills go to the table first, written after the reset they would bring back the history it removes
+    flush_price_ticks();
+
    // Step 1: Delete all but the most recent price for each action_id based on both date_time and daily_time
    std::string delete_old_prices_query = R"(
         DELETE FROM prices
@@ -384,7 +1363,7 @@ void Database_Manager::reset_database_action_prices(const ID& reset_daily_time,
                 SELECT price_id
                 FROM prices p
                 WHERE (p.action_id, p.date_time, p.daily_time) IN (
-                    SELECT p2.date_time, p2.daily_time
+                    SELECT p2.action_id, p2.date_time, p2.daily_time
                     FROM prices p2
                     WHERE p2.action_id = p.action_id
                     AND p2.date_time = (
@@ -402,7 +1381,7 @@ void Database_Manager::reset_database_action_prices(const ID& reset_daily_time,
             )
         );
     )";
-    execute_SQL(delete_old_prices_query);
+    execute_SQL_all_shards(delete_old_prices_query); // every subquery is restricted to one action, so each shard can be cleaned on its own
 
     // Step 2: update the remaining prices with the given reset_time
     std::string update_prices_query = 
@@ -425,7 +1404,10 @@ void Database_Manager::reset_database_action_prices(const ID& reset_daily_time,
                 "AND date_time = p2.date_time "
             ") "
         ");";
-    execute_SQL(update_prices_query);
+    execute_SQL_all_shards(update_prices_query);
+
+    // the cached prices kept their former times, the ticks were flushed before the reset
+    forget_market_cache();
 }
 
 // function to reset the log of the messages
@@ -447,3 +1429,34 @@ void Database_Manager::reset_database_messages()
     execute_SQL(create_messages_table);
 }
 
+
+// SQL_Transaction
+// constructor
+// begin the transaction
+SQL_Transaction::SQL_Transaction(Database_Manager& database) : Database(database), Lock(database.Write_Mutex), Finished(false)
+{
+    Database.execute_SQL("BEGIN IMMEDIATE;"); // take the write lock of the file now, not at the first write
+}
+
+// destructor
+// roll back if not committed
+SQL_Transaction::~SQL_Transaction()
+{
+    if (!Finished){
+        rollback();
+    }
+}
+
+// make the changes durable
+void SQL_Transaction::commit()
+{
+    Database.execute_SQL("COMMIT;");
+    Finished = true;
+}
+
+// cancel the changes
+void SQL_Transaction::rollback()
+{
+    Database.execute_SQL("ROLLBACK;");
+    Finished = true;
+}
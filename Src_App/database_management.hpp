@@ -4,23 +4,132 @@
 #ifndef DATABASE_MANAGEMENT_HPP
 #define DATABASE_MANAGEMENT_HPP
 #include "utility.hpp"
+#include "change_feed.hpp"
+#include "price_aggregator.hpp"
+#include "risk_limits.hpp"
+#include "view_cache.hpp"
+
+
+// PRAGMA tuning profiles, one per deployment environment
+enum class Database_Profile
+{
+    SQLITE_DEFAULT, // rollback journal, synchronous=FULL, small page cache, no mmap
+    DURABLE,        // WAL + synchronous=FULL : no committed transaction is lost, even on power failure
+    BALANCED,       // WAL + synchronous=NORMAL : a power failure can lose the last commits, never corrupts
+    SIMULATION      // in-memory journal + synchronous=OFF : fastest, a crash can corrupt the file
+};
+// converting a string to a Database_Profile enum
+Database_Profile string_to_database_profile(const std::string& profile_str);
+// converting a Database_Profile enum to a string
+std::string database_profile_to_string(const Database_Profile& profile);
+
+
+class Account;
+
+
+// last known price of an action and the time it was set
+struct Price_Point
+{
+    double price;
+    ID date_time;
+    ID daily_time;
+};
+
+
+#define MAX_SHARDS 10 // SQLite refuses more than 10 attached databases by default (SQLITE_MAX_ATTACHED)
 
 
 class Database_Manager
 {
 private:
     sqlite3* Database;
+    std::string Database_Name; // path of the main database file, shard files are named after it
+    std::vector<sqlite3*> Shards; // one writer connection per shard file, empty if the sharding mode is off
+    std::recursive_mutex Write_Mutex; // held by every statement, query and transaction of the main connection : a reader waits for the transaction of another thread instead of seeing its uncommitted rows
+    std::vector<std::unique_ptr<std::recursive_mutex>> Shard_Mutexes; // same for each shard connection
+    Database_Profile Profile; // tuning profile applied to the main connection and to every shard
+
+    void apply_profile_on(sqlite3* database, const Database_Profile& profile); // set the PRAGMAs of a profile on a connection
+    std::unique_ptr<Change_Feed> Feed; // change-data-capture ring, null if the capture is off
+
+    void register_change_hooks(sqlite3* database); // capture the changes made through a connection
+    void resolve_pending_changes(sqlite3* database); // read the values of the rows changed through a connection since the last reading (the write mutex of the connection must be held)
+    void publish_pending_changes(sqlite3* database); // publish the changes of a committed connection, one event per row with its last values
+    std::unique_ptr<Price_Aggregator> Aggregator; // price tick aggregation, null if every price point is written at once
+
+    std::optional<std::string> get_column_type(sqlite3* database, const std::string& table, const std::string& column); // declared type of a column, nullopt if the table has no such column
+    void add_column_if_missing(sqlite3* database, const std::string& table, const std::string& column, const std::string& definition); // upgrade a table created by an older version
+    void convert_column_to_money(sqlite3* database, const std::string& table, const std::string& column); // upgrade a REAL amount column created by an older version to INTEGER money units
+    void write_price_ticks(const std::vector<Price_Tick>& ticks); // insert the ticks in one transaction per shard
+    void forget_market_cache(); // forget the cached prices and names without writing the pending ticks, for a reset that already rewrote the "prices" table
+    std::shared_mutex Market_Mutex; // protects the latest prices and the action names
+    std::unordered_map<ID, Price_Point> Latest_Prices; // action_id -> last price recorded, loaded from the "prices" table on first use
+    std::unordered_map<ID, std::string> Action_Names; // action_id -> name, loaded from the "actions" table on first use
+    std::unordered_map<ID, uint64_t> Price_Versions; // action_id -> market version of the last move of its cached price
+    uint64_t Market_Version = 0; // bumped at each move of a cached price (or clear of the cache), the new value stamps what moved
+    uint64_t Cleared_Version = 0; // market version of the last clear of the cache, every price may have moved then
+    std::mutex Accounts_Mutex; // protects the accounts registry
+    std::unordered_map<ID, std::shared_ptr<Account>> Accounts; // client_id -> in-memory account shared by the Client handles
+    Risk_Limits Default_Risk_Limits; // limits of the accounts loaded from now on
+
+    void execute_SQL_on(sqlite3* database, const std::string& sql); // modify the given database connection
+    std::recursive_mutex& get_write_mutex(sqlite3* database); // mutex owning a connection during a statement or a transaction
+    std::string get_shard_name(const int& shard_index) const; // path of the shard file : <database_name>_shard_<index>.db
+    void attach_shard(const std::string& shard_name, const int& shard_index); // attach a shard file to the main connection as shard_<index>, its path bound as a parameter
+    void create_sharded_tables(sqlite3* database); // create the "prices" and "orders" tables in a shard file
+    void create_sharded_views(); // expose the shards as "prices" and "orders" on the main connection through UNION ALL views
+
 public:
     // constructor
-    Database_Manager(const std::string& database_name);
+    Database_Manager(const std::string& database_name, const Database_Profile& profile = Database_Profile::SQLITE_DEFAULT);
     // destructor
     void close_database();
 
     // getters
     sqlite3* get_database() const;
+    Database_Profile get_profile() const;
+
+    // tuning
+    void apply_profile(const Database_Profile& profile); // set journal_mode, synchronous, cache_size, mmap_size, temp_store and page_size together
+
+    // sharding mode : "prices" and "orders" are split by action_id ranges across several files, each one with its own writer connection
+    void enable_sharding(const int& shard_count); // open (or create) the shard files and attach them to the main connection
+    bool is_sharded() const;
+    int get_shard_index(const ID& action_id) const; // shard owning the rows of an action
+    sqlite3* get_shard_database(const ID& action_id) const; // writer connection of the shard owning the action (the main one if not sharded)
+    void execute_SQL_routed(const ID& action_id, const std::string& sql); // modify the "prices" or "orders" rows of a given action
+    void execute_SQL_all_shards(const std::string& sql); // modify the "prices" or "orders" rows when the action is not known
+
+    // change-data-capture : every committed change of "orders", "prices", "client_portfolio" and "clients" is published in a lock-free ring
+    void enable_change_capture(const size_t& capacity = CHANGE_FEED_CAPACITY); // start capturing the changes (call it before sharing the manager between threads)
+    bool is_change_capture_enabled() const;
+    Change_Subscriber subscribe_changes() const; // read every change committed from now on
+
+    // price points : a trade is counted on its buying leg (quantity > 0), the selling leg only records the price (quantity = 0)
+    void enable_price_aggregation(const ID& bucket_ms = PRICE_BUCKET_MS, const size_t& batch_size = PRICE_BATCH_SIZE); // collapse the fills of an action within a time bucket into one row, written in batches
+    bool is_price_aggregation_enabled() const;
+    void record_price(const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time); // record a fill in the "prices" table (or in the current tick)
+    void flush_price_ticks(); // write every tick, including the ones of the current buckets
+
+    // market cache : the portfolio views are valued without querying the "prices" table
+    std::optional<Price_Point> get_latest_price(const ID& action_id); // last price of an action (written or not), nullopt if it has none
+    std::string get_action_name(const ID& action_id); // name of an action, empty if it does not exist
+    void clear_market_cache(); // forget the cached prices and names, they are loaded again on next use
+    uint64_t get_market_version(const std::vector<ID>& action_ids); // version of the prices of some actions, changes whenever one of their latest prices changes
+
+    // accounts : one in-memory state per client, loaded on first use and kept up to date by the Client writes
+    std::shared_ptr<Account> get_account(const ID& client_id); // get (or load) the account of a client
+    void clear_accounts(); // forget the loaded accounts, they are loaded again from the database on next use
+    void set_default_risk_limits(const Risk_Limits& limits); // limits of every account loaded from now on (Account::set_risk_limits for one client)
+    Risk_Limits get_default_risk_limits();
+    void invalidate_client_view(const ID& client_id, const Client_View& view); // a write not made through the account changed a view of the client (nothing if the account is not loaded)
   
-    // functions to execute an SQL query
+    // functions to execute an SQL query on the main connection, each one locks it for its whole run (a transaction of another thread is waited for)
     void execute_SQL(const std::string& sql); // modify the database
+    int execute_SQL_changes(const std::string& sql); // modify the database and return the number of changed rows (-1 on error), to check a guarded UPDATE
+    void savepoint(const std::string& name); // open a savepoint on the main connection, inside a transaction a part of it can then be undone alone
+    void rollback_to_savepoint(const std::string& name); // undo the changes made since the savepoint (and drop their captured changes), it stays open
+    void release_savepoint(const std::string& name); // keep the changes made since the savepoint and close it
     int execute_SQL_query_int(const std::string& sql); // get an integer result from the database
     std::vector<int> execute_SQL_query_ints(const std::string& query); // get a vector of integers from the database
     ID execute_SQL_query_ID(const std::string& sql); // get an ID result from the database
@@ -36,11 +145,43 @@ public:
     std::vector<unsigned char> execute_SQL_query_blob(const std::string& sql); // get a blob result from the database
     std::vector<std::vector<unsigned char>> execute_SQL_query_blobs(const std::string& query); // get a vector of blobs from the database
 
+    // borrowed blob access : the span points inside SQLite's row buffer and is only valid during the reader call (statement lifetime), nothing is copied
+    bool execute_SQL_query_blob_view(const std::string& query, const std::function<void(std::span<const unsigned char>)>& reader); // read the first blob of the result, false if there is no row
+    int execute_SQL_query_blobs_view(const std::string& query, const std::function<void(std::span<const unsigned char>)>& reader); // read every blob of the result, returns the number of rows
+    // streamed rows : the reader gets the statement positioned on each row, the column values are only valid during the call
+    int execute_SQL_query_rows_view(const std::string& query, const std::function<void(sqlite3_stmt*)>& reader); // read every row of the result in place, returns the number of rows
+    // incremental blob I/O for large values : read straight into a caller buffer without preparing a query
+    int get_blob_size(const std::string& table, const std::string& column, const ID& row_id); // size in bytes of a blob, -1 if it cannot be opened
+    bool read_blob(const std::string& table, const std::string& column, const ID& row_id, std::span<unsigned char> destination, const int& offset = 0); // fill the destination with the blob bytes starting at offset
+    bool load_encryption_keys(const ID& key_id, unsigned char* aes_key, unsigned char* aes_iv); // load a key and IV pair of the "encryption_keys" table into AES_KEY_SIZE and AES_IV_SIZE buffers
+
     // database management
     void create_tables(); // create the tables in the databases
     void reset_database(); // reset all the datas in the database to have a clear market
     void reset_database_action_prices(const ID& reset_daily_time, const ID& reset_date_time); // reset the prices in the database to the actions of the market and the client's portfolio, to the last price and the given time
     void reset_database_messages(); // function to reset the log of the messages
+
+    friend class SQL_Transaction;
+};
+
+
+// transaction on the main connection : BEGIN IMMEDIATE at construction, ROLLBACK at destruction unless committed
+// the main connection is locked until then, the statements and queries of the other threads wait
+class SQL_Transaction
+{
+private:
+    Database_Manager& Database; // manager whose main connection runs the transaction
+    std::unique_lock<std::recursive_mutex> Lock; // ownership of the main connection
+    bool Finished; // committed or rolled back
+
+public:
+    // constructor
+    SQL_Transaction(Database_Manager& database); // begin the transaction
+    // destructor
+    ~SQL_Transaction(); // roll back if not committed
+
+    void commit(); // make the changes durable
+    void rollback(); // cancel the changes
 };
 
 
@@ -123,7 +123,9 @@ void Order::set_quantity(const int& new_quantity)
         new_quantity,
         get_order_id()
     );
-    Database.execute_SQL(query);
+    Database.execute_SQL_all_shards(query); // the order id does not tell which shard holds the order
+    // the pending orders view of the owner shows the quantity
+    Database.invalidate_client_view(Database.execute_SQL_query_ID(fmt::format("SELECT client_id FROM orders WHERE order_id = {}", get_order_id())), Client_View::PENDING_ORDERS);
 }
 
 
@@ -0,0 +1,66 @@
+#include "order_list_renderer.hpp"
+
+
+// text of a column, empty if NULL
+static std::string_view column_text(sqlite3_stmt* stmt, const int& column)
+{
+    const unsigned char* value = sqlite3_column_text(stmt, column);
+    return value ? std::string_view(reinterpret_cast<const char*>(value), sqlite3_column_bytes(stmt, column)) : std::string_view();
+}
+
+
+// getters
+// number of characters rendered
+size_t Order_List_Renderer::size() const
+{
+    return Buffer.size();
+}
+
+// rendered rows, valid until the next change of the renderer
+std::string_view Order_List_Renderer::view() const
+{
+    return std::string_view(Buffer.data(), Buffer.size());
+}
+
+// copy of the rendered rows
+std::string Order_List_Renderer::to_string() const
+{
+    return fmt::to_string(Buffer);
+}
+
+
+// rendering
+// forget the rendered rows
+void Order_List_Renderer::clear()
+{
+    Buffer.clear();
+}
+
+// append the row of a statement selecting ORDER_LIST_COLUMNS
+void Order_List_Renderer::append_row(sqlite3_stmt* stmt)
+{
+    if (Buffer.size() > 0){
+        Buffer.push_back(','); // separator with the previous order
+    }
+    format_two_times(Buffer, sqlite3_column_int64(stmt, 0), sqlite3_column_int64(stmt, 1));
+    // the values are copied as SQLite prints them (a REAL keeps its ".0")
+    fmt::format_to(
+        std::back_inserter(Buffer),
+        " {} {} {} {} {} {} {} {} ",
+        column_text(stmt, 2),
+        column_text(stmt, 3),
+        column_text(stmt, 4),
+        column_text(stmt, 5),
+        column_text(stmt, 6),
+        column_text(stmt, 7),
+        column_text(stmt, 8),
+        column_text(stmt, 9)
+    );
+    format_two_times(Buffer, sqlite3_column_int64(stmt, 10), sqlite3_column_int64(stmt, 11));
+}
+
+// append every row of a query selecting ORDER_LIST_COLUMNS, returns the number of rows
+int Order_List_Renderer::render(Database_Manager& database, const std::string& query)
+{
+    return database.execute_SQL_query_rows_view(query, [this](sqlite3_stmt* stmt){ append_row(stmt); });
+}
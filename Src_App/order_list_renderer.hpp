@@ -0,0 +1,33 @@
+//==========================================================================
+// File that defines the rendering of the order lists sent to the clients
+//==========================================================================
+#ifndef ORDER_LIST_RENDERER_HPP
+#define ORDER_LIST_RENDERER_HPP
+#include "database_management.hpp"
+
+
+// columns to select for a row of an order list, "o" being "orders", "c" "clients" and "a" "actions"
+#define ORDER_LIST_COLUMNS "o.order_time_date, o.order_time_daily, c.name, o.order_type, o.quantity, a.name, o.trigger_type, o.price, o.trigger_price_lower, o.trigger_price_upper, o.expiration_time_date, o.expiration_time_daily, o.order_id"
+
+
+// renders the pending and the completed orders views : order_time client_name order_type quantity action_name trigger_type price trigger_price_lower trigger_price_upper expiration_time,...
+// the rows are formatted straight from the statement into one buffer, kept between the renderings
+class Order_List_Renderer
+{
+private:
+    fmt::memory_buffer Buffer; // rendered rows, its capacity is kept by clear()
+
+public:
+    // getters
+    size_t size() const; // number of characters rendered
+    std::string_view view() const; // rendered rows, valid until the next change of the renderer
+    std::string to_string() const; // copy of the rendered rows
+
+    // rendering
+    void clear(); // forget the rendered rows
+    void append_row(sqlite3_stmt* stmt); // append the row of a statement selecting ORDER_LIST_COLUMNS
+    int render(Database_Manager& database, const std::string& query); // append every row of a query selecting ORDER_LIST_COLUMNS, returns the number of rows
+};
+
+
+#endif // ORDER_LIST_RENDERER_HPP
@@ -0,0 +1,144 @@
+#include "price.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+
+// Tick_Sizes
+// constructor
+// simple init
+Tick_Sizes::Tick_Sizes(const Money& default_size) : Default_Size(default_size)
+{
+    if (default_size <= 0){
+        std::cerr << "Error: the tick size must be positive\n";
+        throw std::runtime_error("Invalid tick size");
+    }
+}
+
+
+// tick size of a symbol (positive)
+void Tick_Sizes::set(const std::string& symbol, const Money& tick_size)
+{
+    if (tick_size <= 0){
+        std::cerr << "Error: the tick size of " << symbol << " must be positive\n";
+        throw std::runtime_error("Invalid tick size");
+    }
+    Sizes[symbol] = tick_size;
+}
+
+// tick size of a symbol, the default one if it has none
+Money Tick_Sizes::get(const std::string& symbol) const
+{
+    auto it = Sizes.find(symbol);
+    return (it != Sizes.end()) ? it->second : Default_Size;
+}
+
+
+// conversions at the text protocol boundary
+// exact decimal text with at most MONEY_DECIMALS decimals, false otherwise : "-12.5" -> -125000
+bool parse_money(const std::string& text, Money& money)
+{
+    size_t i = (!text.empty() && (text[0] == '-' || text[0] == '+')) ? 1 : 0;
+    Money units = 0;
+    int decimals = -1; // -1 until the point
+    bool digits = false;
+    for (; i < text.size(); ++i){
+        char c = text[i];
+        if (c == '.' && decimals < 0){
+            decimals = 0;
+            continue;
+        }
+        if (c < '0' || c > '9' || decimals == MONEY_DECIMALS || units > (INT64_MAX - 9) / 10){
+            return false;
+        }
+        units = units * 10 + (c - '0');
+        digits = true;
+        if (decimals >= 0){
+            ++decimals;
+        }
+    }
+    if (!digits){
+        return false;
+    }
+    for (int d = std::max(decimals, 0); d < MONEY_DECIMALS; ++d){
+        if (units > INT64_MAX / 10){
+            return false;
+        }
+        units *= 10;
+    }
+    money = (text[0] == '-') ? -units : units;
+    return true;
+}
+
+// decimal text without trailing zeros : 1205000 -> "120.5", 1000000 -> "100"
+std::string money_to_string(const Money& money)
+{
+    uint64_t units = (money < 0) ? -static_cast<uint64_t>(money) : static_cast<uint64_t>(money);
+    std::string text = std::to_string(units / MONEY_SCALE);
+    uint64_t fraction = units % MONEY_SCALE;
+    if (fraction > 0){
+        std::string decimals = std::to_string(fraction);
+        decimals.insert(0, MONEY_DECIMALS - decimals.size(), '0');
+        decimals.erase(decimals.find_last_not_of('0') + 1);
+        text += "." + decimals;
+    }
+    return (money < 0) ? "-" + text : text;
+}
+
+// false if the text is not a positive multiple of the tick size up to MAX_PRICE
+bool parse_price(const std::string& text, const Money& tick_size, Price& price)
+{
+    Money money = 0;
+    if (!parse_money(text, money) || money <= 0 || money > MAX_PRICE || money % tick_size != 0){
+        return false;
+    }
+    price = Price(money / tick_size);
+    return true;
+}
+
+std::string price_to_string(const Price& price, const Money& tick_size)
+{
+    return money_to_string(price.get_ticks() * tick_size);
+}
+
+
+// conversions at the boundary of the application
+// nearest amount in money units
+Money money_from_double(const double& amount)
+{
+    return std::llround(amount * MONEY_SCALE);
+}
+
+double money_to_double(const Money& money)
+{
+    return static_cast<double>(money) / MONEY_SCALE;
+}
+
+// nearest tick, a negative price or one above MAX_PRICE gives a negative Price
+Price price_from_double(const double& price, const Money& tick_size)
+{
+    if (!(price >= 0.0) || price * MONEY_SCALE > MAX_PRICE){
+        return Price(-1);
+    }
+    return Price(std::llround(price * MONEY_SCALE / tick_size));
+}
+
+double price_to_double(const Price& price, const Money& tick_size)
+{
+    return money_to_double(price.get_ticks() * tick_size);
+}
+
+
+// settlement
+// quantity x price is at most MAX_NOTIONAL, checked at parse time so that get_notional cannot overflow
+bool fits_notional(const Price& price, const int& quantity, const Money& tick_size)
+{
+    Money unit = price.get_ticks() * tick_size; // at most MAX_PRICE once parsed
+    return quantity <= 0 || unit <= 0 || quantity <= MAX_NOTIONAL / unit;
+}
+
+// quantity x price, exact (for a fill of an order that fits_notional)
+Money get_notional(const Price& price, const int& quantity, const Money& tick_size)
+{
+    return price.get_ticks() * tick_size * quantity;
+}
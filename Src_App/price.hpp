@@ -0,0 +1,80 @@
+//==========================================================================
+// File that defines the fixed-point prices and amounts
+// shared by the application and the matching engine of Engine_Mutex, so it only depends on the standard library
+//==========================================================================
+#ifndef PRICE_HPP
+#define PRICE_HPP
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+
+#define MONEY_DECIMALS 4 // amounts are counted in 1/10000 of the currency
+#define MONEY_SCALE 10000 // money units in 1.0
+#define DEFAULT_TICK_SIZE 100 // price step of a symbol without its own, in money units (0.01)
+#define MAX_PRICE (1000000LL * MONEY_SCALE) // highest price accepted, in money units (1 000 000.0)
+#define MAX_NOTIONAL (100000000000000LL * MONEY_SCALE) // highest quantity x price of an order, in money units : far enough from INT64_MAX for the cash balances to add up
+#define MONEY_TICK_SIZE 1 // tick size of the actions of the application, which have none of their own : the ticks of a price are money units
+
+
+using Money = int64_t; // amount of currency in money units : cash, notionals and tick sizes add up without rounding
+
+
+// price of one symbol, as a number of its ticks
+// compared and used as a level index as an integer, converted to text only at the protocol boundary (with the tick size of the symbol)
+class Price
+{
+private:
+    int64_t Ticks;
+
+public:
+    // constructor
+    constexpr Price() : Ticks(0) {}
+    constexpr explicit Price(const int64_t& ticks) : Ticks(ticks) {}
+
+    // getters
+    constexpr int64_t get_ticks() const { return Ticks; }
+
+    // operators
+    constexpr auto operator<=>(const Price& other) const = default;
+    constexpr Price operator+(const Price& other) const { return Price(Ticks + other.Ticks); }
+    constexpr Price operator-(const Price& other) const { return Price(Ticks - other.Ticks); }
+};
+
+
+// tick size of each symbol, in money units, set before trading and then only read
+class Tick_Sizes
+{
+private:
+    Money Default_Size; // symbols without their own tick size
+    std::unordered_map<std::string, Money> Sizes; // symbol -> tick size
+
+public:
+    // constructor
+    Tick_Sizes(const Money& default_size = DEFAULT_TICK_SIZE); // simple init
+
+    void set(const std::string& symbol, const Money& tick_size); // tick size of a symbol (positive)
+    Money get(const std::string& symbol) const; // tick size of a symbol, the default one if it has none
+};
+
+
+// conversions at the text protocol boundary
+bool parse_money(const std::string& text, Money& money); // exact decimal text with at most MONEY_DECIMALS decimals, false otherwise
+std::string money_to_string(const Money& money); // decimal text without trailing zeros
+bool parse_price(const std::string& text, const Money& tick_size, Price& price); // false if the text is not a positive multiple of the tick size up to MAX_PRICE
+std::string price_to_string(const Price& price, const Money& tick_size);
+
+// conversions at the boundary of the application, whose orders, "prices" table and displays keep doubles
+Money money_from_double(const double& amount); // nearest amount in money units
+double money_to_double(const Money& money);
+Price price_from_double(const double& price, const Money& tick_size); // nearest tick, a negative price or one above MAX_PRICE gives a negative Price
+double price_to_double(const Price& price, const Money& tick_size);
+
+// settlement
+bool fits_notional(const Price& price, const int& quantity, const Money& tick_size); // quantity x price is at most MAX_NOTIONAL, checked at parse time so that get_notional cannot overflow
+Money get_notional(const Price& price, const int& quantity, const Money& tick_size); // quantity x price, exact (for a fill of an order that fits_notional)
+
+
+#endif // PRICE_HPP
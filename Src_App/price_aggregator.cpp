@@ -0,0 +1,60 @@
+#include "price_aggregator.hpp"
+
+
+// constructor
+// simple init
+Price_Aggregator::Price_Aggregator(const ID& bucket_ms, const size_t& batch_size) : Bucket_Ms(std::max<ID>(bucket_ms, 1)), Batch_Size(std::max<size_t>(batch_size, 1))
+{
+
+}
+
+
+// aggregation
+// add a fill to the tick of its bucket, true when a batch is ready
+bool Price_Aggregator::add_fill(const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+    ID bucket = daily_time / Bucket_Ms;
+
+    auto it = Open_Ticks.find(action_id);
+    if (it != Open_Ticks.end()){
+        Price_Tick& tick = it->second;
+        // same bucket of the same day : the fill is folded into the tick
+        if (tick.bucket == bucket && tick.date_time == date_time){
+            tick.price = price;
+            tick.volume += quantity;
+            tick.trade_count += (quantity > 0) ? 1 : 0;
+            tick.daily_time = std::max(tick.daily_time, daily_time);
+            return false;
+        }
+        // otherwise the bucket is over
+        Closed_Ticks.push_back(tick);
+        tick = {action_id, price, quantity, (quantity > 0) ? 1 : 0, date_time, daily_time, bucket};
+    }
+    else {
+        Open_Ticks.emplace(action_id, Price_Tick{action_id, price, quantity, (quantity > 0) ? 1 : 0, date_time, daily_time, bucket});
+    }
+    return Closed_Ticks.size() >= Batch_Size;
+}
+
+// get the ticks of the finished buckets
+std::vector<Price_Tick> Price_Aggregator::take_closed_ticks()
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+    std::vector<Price_Tick> ticks;
+    ticks.swap(Closed_Ticks);
+    return ticks;
+}
+
+// close the current buckets too and get every tick
+std::vector<Price_Tick> Price_Aggregator::take_all_ticks()
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+    std::vector<Price_Tick> ticks;
+    ticks.swap(Closed_Ticks);
+    for (const auto& [action_id, tick] : Open_Ticks){
+        ticks.push_back(tick);
+    }
+    Open_Ticks.clear();
+    return ticks;
+}
@@ -0,0 +1,46 @@
+//==========================================================================
+// File that defines the aggregation of the fills into price ticks
+//==========================================================================
+#ifndef PRICE_AGGREGATOR_HPP
+#define PRICE_AGGREGATOR_HPP
+#include "utility.hpp"
+
+
+#define PRICE_BUCKET_MS 1000 // default width of a price tick, in milliseconds of the day
+#define PRICE_BATCH_SIZE 256 // default number of closed ticks written in one transaction
+
+
+// every fill of an action within one time bucket, stored as a single row of the "prices" table
+struct Price_Tick
+{
+    ID action_id;
+    double price;     // last fill price of the bucket
+    int volume;       // sum of the filled quantities
+    int trade_count;  // number of fills with a quantity
+    ID date_time;     // time of the last fill
+    ID daily_time;
+    ID bucket;        // daily_time / bucket width
+};
+
+
+class Price_Aggregator
+{
+private:
+    ID Bucket_Ms; // width of a bucket
+    size_t Batch_Size; // number of closed ticks that makes a batch ready to be written
+    std::mutex Mutex; // the aggregator is shared by every client handle
+    std::unordered_map<ID, Price_Tick> Open_Ticks; // action_id -> tick of the current bucket
+    std::vector<Price_Tick> Closed_Ticks; // ticks waiting to be written
+
+public:
+    // constructor
+    Price_Aggregator(const ID& bucket_ms = PRICE_BUCKET_MS, const size_t& batch_size = PRICE_BATCH_SIZE); // simple init
+
+    // aggregation
+    bool add_fill(const ID& action_id, const int& quantity, const double& price, const ID& daily_time, const ID& date_time); // add a fill to the tick of its bucket (a zero quantity only moves the price), true when a batch is ready
+    std::vector<Price_Tick> take_closed_ticks(); // get the ticks of the finished buckets
+    std::vector<Price_Tick> take_all_ticks(); // close the current buckets too and get every tick
+};
+
+
+#endif // PRICE_AGGREGATOR_HPP
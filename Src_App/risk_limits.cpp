@@ -0,0 +1,49 @@
+#include "risk_limits.hpp"
+
+
+// converting a Risk_Check enum to a string
+std::string risk_check_to_string(const Risk_Check& check)
+{
+    switch (check){
+        case Risk_Check::ACCEPTED:
+            return "ACCEPTED";
+        case Risk_Check::ORDER_QUANTITY:
+            return "ORDER_QUANTITY";
+        case Risk_Check::NOTIONAL:
+            return "NOTIONAL";
+        case Risk_Check::OPEN_ORDERS:
+            return "OPEN_ORDERS";
+        case Risk_Check::POSITION:
+            return "POSITION";
+        case Risk_Check::ORDER_RATE:
+            return "ORDER_RATE";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+
+// Order_Rate_Limiter
+// constructor
+// full bucket
+Order_Rate_Limiter::Order_Rate_Limiter() : Tokens(std::numeric_limits<double>::max()), Last_Refill(std::chrono::steady_clock::now())
+{
+
+}
+
+// take a token, false if the bucket is empty
+bool Order_Rate_Limiter::take(const int& orders_per_second)
+{
+    if (orders_per_second == std::numeric_limits<int>::max()){
+        return true; // no limit
+    }
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - Last_Refill).count();
+    Last_Refill = now;
+    Tokens = std::min<double>(Tokens + elapsed * orders_per_second, orders_per_second); // the bucket holds one second of orders
+    if (Tokens < 1.0){
+        return false;
+    }
+    Tokens -= 1.0;
+    return true;
+}
@@ -0,0 +1,50 @@
+//==========================================================================
+// File that defines the pre-trade risk limits of a client
+//==========================================================================
+#ifndef RISK_LIMITS_HPP
+#define RISK_LIMITS_HPP
+#include "utility.hpp"
+#include "price.hpp"
+
+
+// limits checked before an order is accepted, a limit at its maximum value is not checked
+struct Risk_Limits
+{
+    int max_order_quantity = std::numeric_limits<int>::max(); // shares in one order
+    Money max_notional = std::numeric_limits<Money>::max();   // quantity x price of one order, in money units (market orders valued as for the reservation)
+    int max_open_orders = std::numeric_limits<int>::max();    // pending orders at the same time
+    int max_position = std::numeric_limits<int>::max();       // shares of one action held plus the pending buys
+    int max_orders_per_second = std::numeric_limits<int>::max(); // orders submitted, accepted or not (burst of one second)
+};
+
+
+// result of a pre-trade risk check
+enum class Risk_Check
+{
+    ACCEPTED,
+    ORDER_QUANTITY, // max_order_quantity exceeded
+    NOTIONAL,       // max_notional exceeded
+    OPEN_ORDERS,    // max_open_orders reached
+    POSITION,       // max_position exceeded
+    ORDER_RATE      // max_orders_per_second exceeded
+};
+// converting a Risk_Check enum to a string
+std::string risk_check_to_string(const Risk_Check& check);
+
+
+// token bucket of the order rate : refilled at the allowed rate, one token per order
+class Order_Rate_Limiter
+{
+private:
+    double Tokens; // orders that can still be sent now
+    std::chrono::steady_clock::time_point Last_Refill;
+
+public:
+    // constructor
+    Order_Rate_Limiter(); // full bucket
+
+    bool take(const int& orders_per_second); // take a token, false if the bucket is empty
+};
+
+
+#endif // RISK_LIMITS_HPP
@@ -0,0 +1,203 @@
+#include "session_registry.hpp"
+
+
+// Session_Lease
+// constructor
+// simple init, the slot is already pinned
+Session_Lease::Session_Lease(Session_Registry* registry, Session_Registry::Session_Slot* slot, const uint32_t& index) : Registry(registry), Slot(slot), Index(index)
+{
+
+}
+
+// the pin moves with the lease
+Session_Lease::Session_Lease(Session_Lease&& other) noexcept : Registry(other.Registry), Slot(other.Slot), Index(other.Index)
+{
+    other.Slot = nullptr;
+}
+
+// destructor
+// unpin the slot
+Session_Lease::~Session_Lease()
+{
+    if (Slot != nullptr){
+        Registry->unpin(*Slot, Index);
+    }
+}
+
+
+// false if the handle was stale
+Session_Lease::operator bool() const
+{
+    return Slot != nullptr;
+}
+
+// the client is not released while the slot is pinned, no lock is needed to reach it
+Client& Session_Lease::operator*() const
+{
+    return *Slot->Session_Client;
+}
+
+Client* Session_Lease::operator->() const
+{
+    return &*Slot->Session_Client;
+}
+
+
+// Session_Registry
+// constructor
+// simple init
+Session_Registry::Session_Registry(Database_Manager& database) : Database(database)
+{
+
+}
+
+
+// the slot of the handle is used by the session that opened it (the lock must be held)
+bool Session_Registry::is_current(const Session_Handle& handle) const
+{
+    return handle.index < Slots.size()
+        && Slots[handle.index].Generation == handle.generation
+        && Slots[handle.index].Session_Client.has_value();
+}
+
+// log the session of a slot out : the slot is released now, or by its last lease (the lock must be held)
+// the new generation refuses the handles of the session at once, the leases already given keep the client until they end
+void Session_Registry::retire(const uint32_t& index)
+{
+    Session_Slot& slot = Slots[index];
+    Slot_Indexes.erase(slot.Session_Client->get_id());
+    // generation 0 is kept for the default handle
+    if (++slot.Generation == 0){
+        slot.Generation = 1;
+    }
+    // stored before the pins are read, as unpin decrements before it reads the flag : one of both sees the other and releases the slot
+    slot.Retired.store(true);
+    if (slot.Pins.load() == 0){
+        release(index);
+    }
+}
+
+// destroy the client of a retired slot no lease pins, and free the slot (the lock must be held)
+// nothing if the slot was already released, or pinned again after being reused
+void Session_Registry::release(const uint32_t& index)
+{
+    Session_Slot& slot = Slots[index];
+    if (!slot.Retired.load() || slot.Pins.load() != 0){
+        return;
+    }
+    slot.Retired.store(false);
+    slot.Session_Client.reset();
+    Free_Slots.push_back(index);
+}
+
+// a lease of the slot ended, the last one of a retired slot releases it
+// only the last lease of a logged out session takes the lock
+void Session_Registry::unpin(Session_Slot& slot, const uint32_t& index)
+{
+    if (slot.Pins.fetch_sub(1) == 1 && slot.Retired.load()){
+        std::unique_lock<std::shared_mutex> lock(Mutex);
+        release(index);
+    }
+}
+
+
+// getters
+size_t Session_Registry::get_session_count() const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return Slot_Indexes.size();
+}
+
+size_t Session_Registry::get_slot_count() const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return Slots.size();
+}
+
+
+// sessions
+// intern the client (the same handle if it is already logged in), the password is checked by the caller
+Session_Handle Session_Registry::login(const ID& client_id)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    auto it = Slot_Indexes.find(client_id);
+    if (it != Slot_Indexes.end()){
+        return {it->second, Slots[it->second].Generation};
+    }
+
+    uint32_t index;
+    if (!Free_Slots.empty()){
+        index = Free_Slots.back();
+        Free_Slots.pop_back();
+    }
+    else {
+        if (Slots.size() >= SESSION_NO_INDEX){
+            std::cerr << "Error: too many sessions\n";
+            throw std::runtime_error("Session slab is full");
+        }
+        index = static_cast<uint32_t>(Slots.size());
+        Slots.emplace_back();
+    }
+    Session_Slot& slot = Slots[index];
+    try {
+        slot.Session_Client.emplace(client_id, Database); // loads the account once for the whole session
+    }
+    catch (...){
+        Free_Slots.push_back(index);
+        throw;
+    }
+    Slot_Indexes.emplace(client_id, index);
+    return {index, slot.Generation};
+}
+
+// release the session, false if the handle was stale
+bool Session_Registry::logout(const Session_Handle& handle)
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    if (!is_current(handle)){
+        return false;
+    }
+    retire(handle.index);
+    return true;
+}
+
+// log every client out, to call after Database_Manager::reset_database (the clients hold the old accounts)
+void Session_Registry::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    while (!Slot_Indexes.empty()){
+        uint32_t index = Slot_Indexes.begin()->second; // a copy : retire erases the entry
+        retire(index);
+    }
+}
+
+// handle of a logged-in client, an invalid one otherwise
+Session_Handle Session_Registry::find(const ID& client_id) const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    auto it = Slot_Indexes.find(client_id);
+    if (it == Slot_Indexes.end()){
+        return {};
+    }
+    return {it->second, Slots[it->second].Generation};
+}
+
+// the handle designates a logged-in session
+bool Session_Registry::is_valid(const Session_Handle& handle) const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    return is_current(handle);
+}
+
+// the interned client, an empty lease if the handle is stale
+// the lock is only held to check the generation and pin the slot : a logout can not retire it in between
+Session_Lease Session_Registry::borrow(const Session_Handle& handle)
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    if (!is_current(handle)){
+        return Session_Lease(this, nullptr, SESSION_NO_INDEX);
+    }
+    Session_Slot& slot = Slots[handle.index];
+    slot.Pins.fetch_add(1);
+    return Session_Lease(this, &slot, handle.index);
+}
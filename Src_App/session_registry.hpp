@@ -0,0 +1,95 @@
+//==========================================================================
+// File that defines the registry of the logged-in clients
+//==========================================================================
+#ifndef SESSION_REGISTRY_HPP
+#define SESSION_REGISTRY_HPP
+#include "client.hpp"
+
+
+#define SESSION_NO_INDEX UINT32_MAX // index of a handle that designates no session
+
+
+// reference to a session : the index of its slot and the generation of the slot when the session was opened
+// a handle kept after the logout is refused, even if the slot was reused by another client
+struct Session_Handle
+{
+    uint32_t index = SESSION_NO_INDEX;
+    uint32_t generation = 0;
+};
+
+
+class Session_Lease;
+
+// one long-lived Client per logged-in client id, interned in a pooled slab
+// the slots are never freed, a logout bumps the generation of the slot and puts it back in the free list once no lease pins it
+// request handlers borrow the interned Client through a handle instead of building a new one per request
+class Session_Registry
+{
+private:
+    friend class Session_Lease;
+
+    // slot of the slab, its address never changes
+    struct Session_Slot
+    {
+        std::optional<Client> Session_Client; // empty when the slot is free
+        uint32_t Generation = 1; // bumped at each logout, 0 is never a valid generation
+        std::atomic<uint32_t> Pins{0}; // leases of the session, the client is kept while there are some
+        std::atomic<bool> Retired{false}; // logged out while pinned : the last lease releases the slot
+    };
+
+    Database_Manager& Database; // reference to the database manager of the clients
+    mutable std::shared_mutex Mutex; // resolving a handle is shared, logging in and out is exclusive
+    std::deque<Session_Slot> Slots; // slab, grows at the back only so the slots keep their address
+    std::vector<uint32_t> Free_Slots; // indexes of the free slots, reused first
+    std::unordered_map<ID, uint32_t> Slot_Indexes; // client_id -> index of its slot
+
+    bool is_current(const Session_Handle& handle) const; // the slot of the handle is used by the session that opened it (the lock must be held)
+    void retire(const uint32_t& index); // log the session of a slot out : the slot is released now, or by its last lease (the lock must be held)
+    void release(const uint32_t& index); // destroy the client of a retired slot no lease pins, and free the slot (the lock must be held)
+    void unpin(Session_Slot& slot, const uint32_t& index); // a lease of the slot ended, the last one of a retired slot releases it
+
+public:
+    // constructor
+    Session_Registry(Database_Manager& database); // simple init
+
+    // getters
+    size_t get_session_count() const; // logged-in clients
+    size_t get_slot_count() const; // slots allocated by the slab, free or not
+
+    // sessions
+    Session_Handle login(const ID& client_id); // intern the client (the same handle if it is already logged in), the password is checked by the caller
+    bool logout(const Session_Handle& handle); // release the session, false if the handle was stale
+    void clear(); // log every client out, to call after Database_Manager::reset_database (the clients hold the old accounts)
+    Session_Handle find(const ID& client_id) const; // handle of a logged-in client, an invalid one otherwise
+    bool is_valid(const Session_Handle& handle) const; // the handle designates a logged-in session
+    Session_Lease borrow(const Session_Handle& handle); // the interned client, an empty lease if the handle is stale
+};
+
+
+// borrowed session : the client is kept alive while the lease exists, even if it logs out meanwhile
+// the lease pins the slot, it holds no lock : the thread holding it may log clients in or out, its own one included
+// a lease must not outlive its registry
+class Session_Lease
+{
+private:
+    Session_Registry* Registry;
+    Session_Registry::Session_Slot* Slot; // nullptr if the handle was stale
+    uint32_t Index;
+
+public:
+    // constructor
+    Session_Lease(Session_Registry* registry, Session_Registry::Session_Slot* slot, const uint32_t& index); // simple init, the slot is already pinned
+    Session_Lease(Session_Lease&& other) noexcept; // the pin moves with the lease
+    // destructor
+    ~Session_Lease(); // unpin the slot
+    Session_Lease(const Session_Lease&) = delete;
+    Session_Lease& operator=(const Session_Lease&) = delete;
+    Session_Lease& operator=(Session_Lease&&) = delete;
+
+    explicit operator bool() const; // false if the handle was stale
+    Client& operator*() const;
+    Client* operator->() const;
+};
+
+
+#endif // SESSION_REGISTRY_HPP
@@ -0,0 +1,226 @@
+#include "settlement_batch.hpp"
+
+
+// constructor
+// simple init
+Settlement_Batch::Settlement_Batch(Database_Manager& database) : Database(database)
+{
+
+}
+
+
+// getters
+// number of fills waiting
+size_t Settlement_Batch::size() const
+{
+    return Fills.size();
+}
+
+bool Settlement_Batch::empty() const
+{
+    return Fills.empty();
+}
+
+
+// batch management
+// add a leg of a trade to the batch, the fill of a pending order (-1 : none)
+void Settlement_Batch::add_fill(const ID& client_id, const Order_Type& order_type, const ID& action_id, const int& quantity, const Price& price, const ID& daily_time, const ID& date_time, const ID& order_id)
+{
+    if (quantity <= 0 || price < Price() || !fits_notional(price, quantity, MONEY_TICK_SIZE)){
+        std::cerr << "Error: Invalid fill for client " << client_id << ".\n";
+        return;
+    }
+    Fills.push_back({client_id, order_type, action_id, quantity, price, daily_time, date_time, order_id});
+}
+
+// drop the fills without settling them
+void Settlement_Batch::clear()
+{
+    Fills.clear();
+}
+
+// net the fills per (client, action), sorted by client_id then action_id
+std::vector<Net_Position> Settlement_Batch::get_net_positions()
+{
+    std::vector<Net_Position> positions;
+    positions.reserve(Fills.size());
+    for (const Settlement_Fill& fill : Fills){
+        Money amount = get_notional(fill.price, fill.quantity, MONEY_TICK_SIZE);
+        if (fill.order_type == Order_Type::BUY){
+            positions.push_back({fill.client_id, fill.action_id, fill.quantity, amount, 0, 0});
+        }
+        else {
+            positions.push_back({fill.client_id, fill.action_id, 0, 0, fill.quantity, amount});
+        }
+    }
+    // sorted keys : the rows of "clients" and "client_portfolio" are visited in B-tree order
+    std::sort(positions.begin(), positions.end(), [](const Net_Position& a, const Net_Position& b){
+        return std::tie(a.client_id, a.action_id) < std::tie(b.client_id, b.action_id);
+    });
+
+    // merge the positions with the same key
+    size_t last = 0;
+    for (size_t i = 1; i < positions.size(); ++i){
+        if (positions[i].client_id == positions[last].client_id && positions[i].action_id == positions[last].action_id){
+            positions[last].bought += positions[i].bought;
+            positions[last].cost += positions[i].cost;
+            positions[last].sold += positions[i].sold;
+            positions[last].proceeds += positions[i].proceeds;
+        }
+        else {
+            positions[++last] = positions[i];
+        }
+    }
+    if (!positions.empty()){
+        positions.resize(last + 1);
+    }
+    return positions;
+}
+
+// settle every fill and empty the batch, returns the clients whose net position was refused (nothing of theirs is written)
+std::vector<ID> Settlement_Batch::apply()
+{
+    std::vector<ID> refused_clients;
+    if (Fills.empty()){
+        return refused_clients;
+    }
+    std::vector<Net_Position> positions = get_net_positions();
+
+    // accounts are locked in client_id order before the connection, as Account::settle does : no deadlock between batches and single settlements
+    std::vector<std::shared_ptr<Account>> accounts;
+    std::vector<std::unique_lock<std::shared_mutex>> account_locks;
+    for (const Net_Position& position : positions){
+        if (accounts.empty() || accounts.back()->get_client_id() != position.client_id){
+            accounts.push_back(Database.get_account(position.client_id));
+            account_locks.emplace_back(accounts.back()->Mutex);
+        }
+    }
+
+    // quantity filled of each pending order, per account : the batch releases their reservations
+    std::vector<std::unordered_map<ID, int>> order_fills(accounts.size());
+    for (const Settlement_Fill& fill : Fills){
+        if (fill.order_id >= 0){
+            auto account = std::lower_bound(accounts.begin(), accounts.end(), fill.client_id, [](const std::shared_ptr<Account>& a, const ID& client_id){
+                return a->get_client_id() < client_id;
+            });
+            order_fills[account - accounts.begin()][fill.order_id] += fill.quantity;
+        }
+    }
+
+    sqlite3* database = Database.get_database();
+    std::vector<bool> accepted(accounts.size(), false);
+    std::vector<Holding> holdings(positions.size()); // new state of each position, given to memory once committed
+    std::vector<bool> written(positions.size(), false); // false : a position netted to zero on an action the client did not hold, nothing to write
+    {
+        SQL_Transaction transaction(Database);
+        sqlite3_stmt* cash_stmt = nullptr;
+        sqlite3_stmt* buy_stmt = nullptr;
+        sqlite3_stmt* sell_stmt = nullptr;
+        // a debit can not spend the funds reserved by the pending buy orders (?3, bound from memory), a credit is always accepted
+        sqlite3_prepare_v2(database, "UPDATE clients SET balance = balance + ?1 WHERE client_id = ?2 AND (?1 >= 0 OR balance - ?3 + ?1 >= 0)", -1, &cash_stmt, nullptr);
+        sqlite3_prepare_v2(database, "INSERT INTO client_portfolio (client_id, action_id, quantity, average_cost, realized_pnl) VALUES (?1, ?2, ?3, ?4, ?5) ON CONFLICT(client_id, action_id) DO UPDATE SET quantity = quantity + excluded.quantity, average_cost = excluded.average_cost, realized_pnl = excluded.realized_pnl", -1, &buy_stmt, nullptr);
+        sqlite3_prepare_v2(database, "UPDATE client_portfolio SET quantity = quantity + ?3, average_cost = ?4, realized_pnl = ?5 WHERE client_id = ?1 AND action_id = ?2 AND quantity + ?3 >= 0", -1, &sell_stmt, nullptr);
+        if (!cash_stmt || !buy_stmt || !sell_stmt){
+            std::cerr << "Error preparing the settlement statements: " << sqlite3_errmsg(database) << std::endl;
+            sqlite3_finalize(cash_stmt);
+            sqlite3_finalize(buy_stmt);
+            sqlite3_finalize(sell_stmt);
+            throw std::runtime_error("Error preparing the settlement statements");
+        }
+
+        // run a prepared statement, true if it changed exactly one row
+        auto step_one_row = [database](sqlite3_stmt* stmt){
+            bool ok = sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(database) == 1;
+            sqlite3_reset(stmt);
+            return ok;
+        };
+
+        size_t first = 0;
+        for (size_t a = 0; a < accounts.size(); ++a){
+            ID client_id = accounts[a]->get_client_id();
+            size_t end = first;
+            Money net_cash = 0;
+            while (end < positions.size() && positions[end].client_id == client_id){
+                net_cash += positions[end].proceeds - positions[end].cost;
+                ++end;
+            }
+
+            // every write of a client is undone together if one of its guards fails
+            Database.savepoint("settlement_client");
+            bool ok = true;
+            sqlite3_bind_int64(cash_stmt, 1, net_cash);
+            sqlite3_bind_int64(cash_stmt, 2, client_id);
+            Money reserved = accounts[a]->Reserved; // what the filled orders of the batch release can be spent
+            for (const auto& [order_id, quantity] : order_fills[a]){
+                reserved -= accounts[a]->get_released(order_id, quantity);
+            }
+            sqlite3_bind_int64(cash_stmt, 3, reserved);
+            ok = step_one_row(cash_stmt);
+            for (size_t p = first; ok && p < end; ++p){
+                const Net_Position& position = positions[p];
+                holdings[p] = accounts[a]->get_holding_copy(position.action_id);
+                Account::apply_buy(holdings[p], position.bought, position.cost);
+                Account::apply_sell(holdings[p], position.sold, position.proceeds);
+                int quantity = position.bought - position.sold;
+                auto held = accounts[a]->find_holding(position.action_id);
+                written[p] = quantity != 0 || (held != accounts[a]->Holdings.end() && held->action_id == position.action_id);
+                if (!written[p]){
+                    continue;
+                }
+                // the shares of a net buy can create the row, a net sell must find enough of them,
+                // a position netted to zero only updates the cost basis of the existing row, it never creates an empty one
+                sqlite3_stmt* stmt = (quantity > 0) ? buy_stmt : sell_stmt;
+                sqlite3_bind_int64(stmt, 1, client_id);
+                sqlite3_bind_int64(stmt, 2, position.action_id);
+                sqlite3_bind_int(stmt, 3, quantity);
+                sqlite3_bind_double(stmt, 4, holdings[p].average_cost);
+                sqlite3_bind_double(stmt, 5, holdings[p].realized_pnl);
+                ok = step_one_row(stmt);
+            }
+            if (!ok){
+                Database.rollback_to_savepoint("settlement_client");
+                refused_clients.push_back(client_id);
+            }
+            Database.release_savepoint("settlement_client");
+            accepted[a] = ok;
+            first = end;
+        }
+
+        sqlite3_finalize(cash_stmt);
+        sqlite3_finalize(buy_stmt);
+        sqlite3_finalize(sell_stmt);
+        transaction.commit();
+    }
+
+    // the memory follows the committed database, the accounts are still locked
+    size_t first = 0;
+    for (size_t a = 0; a < accounts.size(); ++a){
+        Account& account = *accounts[a];
+        for (; first < positions.size() && positions[first].client_id == account.get_client_id(); ++first){
+            if (!accepted[a]){
+                continue;
+            }
+            const Net_Position& position = positions[first];
+            account.Balance += position.proceeds - position.cost;
+            if (written[first]){
+                account.set_holding(holdings[first]);
+            }
+            account.Views.invalidate(Client_View::PORTFOLIO);
+        }
+        if (accepted[a]){
+            for (const auto& [order_id, quantity] : order_fills[a]){
+                account.fill_open_order(order_id, quantity);
+            }
+        }
+    }
+    account_locks.clear();
+
+    // record the price of every fill of the accepted clients (the buying leg counts the traded quantity)
+    for (const Settlement_Fill& fill : Fills){
+        if (!std::binary_search(refused_clients.begin(), refused_clients.end(), fill.client_id)){ // refused in client_id order
+            Database.record_price(fill.action_id, (fill.order_type == Order_Type::BUY) ? fill.quantity : 0, price_to_double(fill.price, MONEY_TICK_SIZE), fill.daily_time, fill.date_time);
+        }
+    }
+    Fills.clear();
+    return refused_clients;
+}
@@ -0,0 +1,66 @@
+//==========================================================================
+// File that defines the settlement of many fills in one transaction
+//==========================================================================
+#ifndef SETTLEMENT_BATCH_HPP
+#define SETTLEMENT_BATCH_HPP
+#include "database_management.hpp"
+#include "order.hpp"
+#include "account.hpp"
+
+
+// one leg of a trade, as given to Client::update_portfolio
+struct Settlement_Fill
+{
+    ID client_id;
+    Order_Type order_type;
+    ID action_id;
+    int quantity;
+    Price price; // in ticks of MONEY_TICK_SIZE
+    ID daily_time;
+    ID date_time;
+    ID order_id; // pending order filled, its reservation is released, -1 : none
+};
+
+
+// sum of the fills of one client on one action
+struct Net_Position
+{
+    ID client_id;
+    ID action_id;
+    int bought;
+    Money cost;     // sum of quantity x price of the buys
+    int sold;
+    Money proceeds; // sum of quantity x price of the sells
+};
+
+
+// gathers the fills of a matching pass (or of an auction) and settles them at once :
+// the fills are netted per (client, action), sorted by key, and every net position is written once in a single transaction
+// the guards of Account::settle are checked on the net position of each client, a refused client leaves the others untouched
+// as in Account::settle, the accounts of the batch stay locked from the guards to the memory update : the locks serialize the settlements,
+// the cash guard binds the in-memory reservation minus what the filled orders of the batch release
+// within a batch the buys of a position are applied before its sells for the cost basis
+class Settlement_Batch
+{
+private:
+    Database_Manager& Database; // reference to the database manager for queries
+    std::vector<Settlement_Fill> Fills; // fills waiting to be settled
+
+    std::vector<Net_Position> get_net_positions(); // net the fills per (client, action), sorted by client_id then action_id
+
+public:
+    // constructor
+    Settlement_Batch(Database_Manager& database); // simple init
+
+    // getters
+    size_t size() const; // number of fills waiting
+    bool empty() const;
+
+    // batch management
+    void add_fill(const ID& client_id, const Order_Type& order_type, const ID& action_id, const int& quantity, const Price& price, const ID& daily_time, const ID& date_time, const ID& order_id = -1); // add a leg of a trade to the batch, the fill of a pending order (-1 : none), ignored if its notional exceeds MAX_NOTIONAL
+    void clear(); // drop the fills without settling them
+    std::vector<ID> apply(); // settle every fill and empty the batch, returns the clients whose net position was refused (nothing of theirs is written)
+};
+
+
+#endif // SETTLEMENT_BATCH_HPP
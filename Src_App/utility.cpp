@@ -90,6 +90,61 @@ std::string two_times_to_string(ID date_time, ID daily_time)
     return std::string(buffer);
 }
 
+// "00" to "99", two characters per number
+static constexpr std::array<char, 200> two_digits_table = [](){
+    std::array<char, 200> table{};
+    for (int i = 0; i < 100; ++i){
+        table[2 * i] = static_cast<char>('0' + i / 10);
+        table[2 * i + 1] = static_cast<char>('0' + i % 10);
+    }
+    return table;
+}();
+
+// append the same string to a buffer, the digits are copied from a lookup table instead of formatted
+void format_two_times(fmt::memory_buffer& buffer, ID date_time, ID daily_time)
+{
+    // get the time in the day
+    int hours = daily_time / MS_IN_H;
+    int minutes = (daily_time % MS_IN_H) / MS_IN_M;
+    int seconds = (daily_time % MS_IN_M) / MS_IN_S;
+    int milliseconds = daily_time % MS_IN_S;
+
+    // get the date
+    int year = date_time / (D_IN_M * M_IN_Y) + 1900;
+    int month = (date_time % (D_IN_M * M_IN_Y)) / D_IN_M + 1;
+    int day = date_time % D_IN_M;
+
+    // a field out of its usual width (negative or too large times) is formatted by two_times_to_string
+    if (year < 0 || year > 9999 || hours < 0 || hours > 99 || daily_time < 0 || day < 0 || month < 1){
+        std::string fallback = two_times_to_string(date_time, daily_time);
+        buffer.append(fallback.data(), fallback.data() + fallback.size());
+        return;
+    }
+
+    // YYYY-MM-DD HH:MM:SS.mmm
+    char text[23];
+    auto copy_two = [&text](const int& position, const int& value){
+        text[position] = two_digits_table[2 * value];
+        text[position + 1] = two_digits_table[2 * value + 1];
+    };
+    copy_two(0, year / 100);
+    copy_two(2, year % 100);
+    text[4] = '-';
+    copy_two(5, month);
+    text[7] = '-';
+    copy_two(8, day);
+    text[10] = ' ';
+    copy_two(11, hours);
+    text[13] = ':';
+    copy_two(14, minutes);
+    text[16] = ':';
+    copy_two(17, seconds);
+    text[19] = '.';
+    text[20] = static_cast<char>('0' + milliseconds / 100);
+    copy_two(21, milliseconds % 100);
+    buffer.append(text, text + sizeof(text));
+}
+
 // get the date from a string : "YYYY-MM-DD" -> YYYY*12*31 + MM*31 + DD
 ID get_date_id_from_string(const std::string& date_str)
 {
@@ -168,7 +223,7 @@ std::string decrypt_AES(const std::string& ciphertext, unsigned char* key, unsig
 }
 
 
-void send_full_string(int sock, const std::string &data, std::mutex &send_mtx)
+void send_full_string(int sock, std::string_view data, std::mutex &send_mtx)
 {
     std::lock_guard<std::mutex> lock(send_mtx);
     uint64_t msg_size = data.size();
@@ -190,7 +245,7 @@ void send_full_string(int sock, const std::string &data, std::mutex &send_mtx)
 }
 
 
-std::string recv_full_string(int sock, std::string &leftover, std::mutex &recv_mtx, int timeout_sec = 10)
+std::string recv_full_string(int sock, std::string &leftover, std::mutex &recv_mtx, int timeout_sec)
 {   
     std::lock_guard<std::mutex> lock(recv_mtx);
     uint64_t net_size;
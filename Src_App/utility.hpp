@@ -8,20 +8,25 @@
 
 #include <algorithm>
 #include <arpa/inet.h>
+#include <array>
 #include <atomic>
+#include <bit>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <ctime>
 #include <fcntl.h>
 #include <filesystem>
 #include <fmt/core.h>
+#include <fmt/format.h>
 #include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
@@ -30,8 +35,11 @@
 #include <optional>
 #include <random>
 #include <set>
+#include <shared_mutex>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <termios.h>
@@ -97,6 +105,8 @@ ID get_daily_time(Time time_ms);
 ID get_date_time(Time time_ms);
 // convert the daily time and date time to a string (YYYY-MM-DD HH:MM:SS.mmm)
 std::string two_times_to_string(ID date_time, ID daily_time);
+// append the same string to a buffer, the digits are copied from a lookup table instead of formatted
+void format_two_times(fmt::memory_buffer& buffer, ID date_time, ID daily_time);
 // get the date from a string : "YYYY-MM-DD" -> YYYY*12*31 + MM*31 + DD
 ID get_date_id_from_string(const std::string& date_str);
 // get the daily time from a string : "HH:MM:SS.mmm" -> HH*60*60*1000 + MM*60*1000 + SS*1000 + mmm
@@ -146,7 +156,7 @@ std::string decrypt_AES(const std::string& ciphertext, unsigned char* key, unsig
 // Sending and receiving messages over the network
 /////////////////////////////////////////////////////////////////////////////////////
 // send safely a message through a socket
-void send_full_string(int sock, const std::string &data, std::mutex &send_mtx);
+void send_full_string(int sock, std::string_view data, std::mutex &send_mtx);
 
 // read safely a message from a socket
 std::string recv_full_string(int sock, std::string &leftover, std::mutex &recv_mtx, int timeout_sec = 10);
@@ -0,0 +1,170 @@
+#include "valuation_engine.hpp"
+
+
+// constructor
+// start the workers
+Valuation_Engine::Valuation_Engine(Database_Manager& database, const size_t& thread_count) : Database(database), Thread_Count(std::max<size_t>(thread_count, 1)), Round(0), Remaining(0), Output(nullptr), Stopping(false)
+{
+    for (size_t worker = 0; worker + 1 < Thread_Count; ++worker){
+        Workers.emplace_back(&Valuation_Engine::work, this, worker);
+    }
+}
+
+// destructor
+// stop and join the workers
+Valuation_Engine::~Valuation_Engine()
+{
+    {
+        std::lock_guard<std::mutex> lock(Pool_Mutex);
+        Stopping = true;
+    }
+    Work_Ready.notify_all();
+    for (auto& worker : Workers){
+        worker.join();
+    }
+}
+
+
+// getters
+size_t Valuation_Engine::get_client_count() const
+{
+    return Client_Ids.size();
+}
+
+size_t Valuation_Engine::get_position_count() const
+{
+    return Positions.size();
+}
+
+
+// valuation
+// copy the latest prices, the balances and the holdings
+void Valuation_Engine::take_snapshot()
+{
+    // latest prices from the market cache (recorded fills included), resolved once to a dense index
+    std::unordered_map<ID, size_t> price_indexes;
+    Prices.clear();
+    for (const ID& action_id : Database.execute_SQL_query_IDs("SELECT action_id FROM actions ORDER BY action_id")){
+        std::optional<Price_Point> latest_price = Database.get_latest_price(action_id);
+        price_indexes.emplace(action_id, Prices.size());
+        Prices.push_back(latest_price ? latest_price->price : 0.0);
+    }
+
+    // balances and holdings in one statement, so they come from the same state of the database
+    Client_Ids.clear();
+    Balances.clear();
+    First_Positions.clear();
+    Positions.clear();
+    std::string query = R"(SELECT c.client_id, c.balance, cp.action_id, cp.quantity, cp.average_cost, cp.realized_pnl
+        FROM clients c LEFT JOIN client_portfolio cp ON cp.client_id = c.client_id
+        ORDER BY c.client_id)";
+    Database.execute_SQL_query_rows_view(query, [this, &price_indexes](sqlite3_stmt* stmt){
+        ID client_id = sqlite3_column_int64(stmt, 0);
+        if (Client_Ids.empty() || Client_Ids.back() != client_id){
+            Client_Ids.push_back(client_id);
+            Balances.push_back(money_to_double(sqlite3_column_int64(stmt, 1))); // money units in the table
+            First_Positions.push_back(Positions.size());
+        }
+        if (sqlite3_column_type(stmt, 2) == SQLITE_NULL){
+            return; // client without holdings
+        }
+        auto it = price_indexes.find(sqlite3_column_int64(stmt, 2));
+        if (it == price_indexes.end()){
+            return; // holding of an unknown action
+        }
+        Positions.push_back({it->second, sqlite3_column_int(stmt, 3), sqlite3_column_double(stmt, 4), sqlite3_column_double(stmt, 5)});
+    });
+    First_Positions.push_back(Positions.size());
+}
+
+// value the clients of a range
+void Valuation_Engine::value_range(const size_t& first_client, const size_t& end_client, std::vector<Client_Valuation>& valuations) const
+{
+    for (size_t i = first_client; i < end_client; ++i){
+        Client_Valuation valuation = {Client_Ids[i], Balances[i], 0.0, 0.0, 0.0, 0.0, 0.0};
+        for (size_t p = First_Positions[i]; p < First_Positions[i + 1]; ++p){
+            const Valuation_Position& position = Positions[p];
+            double price = Prices[position.price_index];
+            double value = position.quantity * price;
+            valuation.market_value += value;
+            valuation.exposure += std::abs(value);
+            valuation.unrealized_pnl += position.quantity * (price - position.average_cost);
+            valuation.realized_pnl += position.realized_pnl;
+        }
+        valuation.equity = valuation.balance + valuation.market_value;
+        valuations[i] = valuation;
+    }
+}
+
+// value the range of the worker at each round, until the engine stops
+void Valuation_Engine::work(const size_t& worker)
+{
+    uint64_t round = 0;
+    while (true){
+        size_t first_client = 0;
+        size_t end_client = 0;
+        std::vector<Client_Valuation>* valuations = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(Pool_Mutex);
+            Work_Ready.wait(lock, [this, &round]{ return Stopping || Round != round; });
+            if (Stopping){
+                return;
+            }
+            round = Round;
+            first_client = Bounds[worker + 1];
+            end_client = Bounds[worker + 2];
+            valuations = Output;
+        }
+        value_range(first_client, end_client, *valuations);
+        {
+            std::lock_guard<std::mutex> lock(Pool_Mutex);
+            if (--Remaining == 0){
+                Work_Done.notify_one();
+            }
+        }
+    }
+}
+
+// value every client of the snapshot, sorted by client_id
+std::vector<Client_Valuation> Valuation_Engine::value_clients() const
+{
+    size_t client_count = Client_Ids.size();
+    std::vector<Client_Valuation> valuations(client_count);
+    if (Workers.empty() || client_count <= 1){
+        value_range(0, client_count, valuations);
+        return valuations;
+    }
+
+    // contiguous ranges with the same number of positions, each thread writes its own part of the result
+    std::vector<size_t> bounds(Thread_Count + 1, client_count);
+    bounds[0] = 0;
+    for (size_t t = 1; t < Thread_Count; ++t){
+        size_t target = Positions.size() * t / Thread_Count;
+        bounds[t] = std::upper_bound(First_Positions.begin() + bounds[t - 1], First_Positions.end() - 1, target) - First_Positions.begin();
+        bounds[t] = std::max(bounds[t], bounds[t - 1]);
+    }
+
+    std::lock_guard<std::mutex> valuation_lock(Valuation_Mutex);
+    {
+        std::lock_guard<std::mutex> lock(Pool_Mutex);
+        Bounds.swap(bounds);
+        Output = &valuations;
+        Remaining = Workers.size();
+        ++Round;
+    }
+    Work_Ready.notify_all();
+    value_range(Bounds[0], Bounds[1], valuations); // the workers only read Bounds until the round is over
+    {
+        std::unique_lock<std::mutex> lock(Pool_Mutex);
+        Work_Done.wait(lock, [this]{ return Remaining == 0; });
+        Output = nullptr;
+    }
+    return valuations;
+}
+
+// snapshot then valuation
+std::vector<Client_Valuation> Valuation_Engine::run()
+{
+    take_snapshot();
+    return value_clients();
+}
@@ -0,0 +1,86 @@
+//==========================================================================
+// File that defines the mark-to-market valuation of every client at once
+//==========================================================================
+#ifndef VALUATION_ENGINE_HPP
+#define VALUATION_ENGINE_HPP
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "database_management.hpp"
+
+
+// valuation of one client at the snapshot prices
+struct Client_Valuation
+{
+    ID client_id;
+    double balance;
+    double market_value;   // sum of quantity x price
+    double equity;         // balance + market value
+    double exposure;       // sum of |quantity x price|
+    double unrealized_pnl; // sum of quantity x (price - average cost)
+    double realized_pnl;
+};
+
+
+// one row of the "client_portfolio" table, with the action resolved to its index in the price snapshot
+struct Valuation_Position
+{
+    size_t price_index;
+    int quantity;
+    double average_cost;
+    double realized_pnl;
+};
+
+
+// values every client from one snapshot : a single statement reads the balances and holdings into flat arrays,
+// then the clients are split in contiguous ranges, each valued in one pass over its positions by a thread of the engine
+// meant to run at the CLOSE_PHASE, the snapshot is consistent (one statement) and the valuation never touches SQLite
+// the worker threads are started with the engine and wait between valuations : a valuation only wakes them up
+class Valuation_Engine
+{
+private:
+    Database_Manager& Database; // reference to the database manager for the snapshot
+    size_t Thread_Count; // number of threads of a valuation, the calling one included
+
+    // snapshot
+    std::vector<double> Prices; // latest price of each action, by price index (0 for an action without price)
+    std::vector<ID> Client_Ids; // clients sorted by client_id
+    std::vector<double> Balances; // balance of each client
+    std::vector<size_t> First_Positions; // positions of client i are [First_Positions[i], First_Positions[i + 1])
+    std::vector<Valuation_Position> Positions; // flat holdings array, grouped by client
+
+    // workers : the calling thread values the first range, worker w the range w + 1
+    std::vector<std::thread> Workers;
+    mutable std::mutex Valuation_Mutex; // one valuation at a time on the workers
+    mutable std::mutex Pool_Mutex; // protects the fields below
+    mutable std::condition_variable Work_Ready; // a round started, or the engine stops
+    mutable std::condition_variable Work_Done; // the last worker of a round finished
+    mutable uint64_t Round; // valuations given to the workers
+    mutable size_t Remaining; // workers still valuing their range in the current round
+    mutable std::vector<size_t> Bounds; // the range of thread t is [Bounds[t], Bounds[t + 1])
+    mutable std::vector<Client_Valuation>* Output; // result of the current round
+    bool Stopping;
+
+    void value_range(const size_t& first_client, const size_t& end_client, std::vector<Client_Valuation>& valuations) const; // value the clients of a range
+    void work(const size_t& worker); // value the range of the worker at each round, until the engine stops
+
+public:
+    // constructor
+    Valuation_Engine(Database_Manager& database, const size_t& thread_count = std::max(1u, std::thread::hardware_concurrency())); // start the workers
+    // destructor
+    ~Valuation_Engine(); // stop and join the workers
+    Valuation_Engine(const Valuation_Engine&) = delete;
+    Valuation_Engine& operator=(const Valuation_Engine&) = delete;
+
+    // getters
+    size_t get_client_count() const; // clients of the last snapshot
+    size_t get_position_count() const; // holdings of the last snapshot
+
+    // valuation
+    void take_snapshot(); // copy the latest prices, the balances and the holdings
+    std::vector<Client_Valuation> value_clients() const; // value every client of the snapshot, sorted by client_id
+    std::vector<Client_Valuation> run(); // snapshot then valuation
+};
+
+
+#endif // VALUATION_ENGINE_HPP
@@ -0,0 +1,25 @@
+#include "view_cache.hpp"
+
+
+// the data of the view changed
+void View_Cache::invalidate(const Client_View& view)
+{
+    Versions[static_cast<size_t>(view)].fetch_add(1, std::memory_order_release);
+}
+
+// copy of the cached payload, rendered again if the view or the market changed since
+std::string View_Cache::get(const Client_View& view, const uint64_t& market_version, const std::function<std::string()>& render)
+{
+    size_t index = static_cast<size_t>(view);
+    std::lock_guard<std::mutex> lock(Mutex);
+    // the version is read before the rendering : a write during the rendering leaves the entry outdated, never wrongly valid
+    uint64_t version = Versions[index].load(std::memory_order_acquire);
+    Entry& entry = Entries[index];
+    if (!entry.valid || entry.version != version || entry.market_version != market_version){
+        entry.payload = render();
+        entry.version = version;
+        entry.market_version = market_version;
+        entry.valid = true;
+    }
+    return entry.payload;
+}
@@ -0,0 +1,41 @@
+//==========================================================================
+// File that defines the cache of the display payloads of a client
+//==========================================================================
+#ifndef VIEW_CACHE_HPP
+#define VIEW_CACHE_HPP
+#include "utility.hpp"
+
+
+// payloads sent for the DISPLAY_PORTFOLIO and DISPLAY_PENDING_ORDERS requests (the completed orders are streamed by pages, never cached)
+enum class Client_View
+{
+    PORTFOLIO,
+    PENDING_ORDERS
+};
+#define CLIENT_VIEW_COUNT 2
+
+
+// last payload of each view with the versions it was rendered from
+// a write of the client bumps the version of the views it changes, the payload is rendered again on the next display only
+class View_Cache
+{
+private:
+    struct Entry
+    {
+        std::string payload;
+        uint64_t version = 0;        // version of the view when rendered
+        uint64_t market_version = 0; // version of the prices of the held actions when rendered (portfolio only)
+        bool valid = false;
+    };
+
+    std::mutex Mutex; // one rendering at a time per client
+    std::array<Entry, CLIENT_VIEW_COUNT> Entries;
+    std::array<std::atomic<uint64_t>, CLIENT_VIEW_COUNT> Versions{}; // bumped by the writes, without taking the mutex
+
+public:
+    void invalidate(const Client_View& view); // the data of the view changed
+    std::string get(const Client_View& view, const uint64_t& market_version, const std::function<std::string()>& render); // copy of the cached payload, rendered again if the view or the market changed since
+};
+
+
+#endif // VIEW_CACHE_HPP
@@ -0,0 +1,130 @@
+#include "order_book.hpp"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+
+#define DEFAULT_MAX_ORDERS 1000000
+#define SEED 42
+#define LOW_PRICE 120.0 // the accumulated orders are priced between LOW_PRICE and HIGH_PRICE, buys and sells overlap
+#define HIGH_PRICE 130.0
+
+
+// ---------------- Workloads ----------------
+struct Workload_Order {
+    bool buy;
+    int quantity;
+    int64_t tick;
+    int client_id;
+};
+
+// random side, 1 to 50 shares, a price with 2 decimals between LOW_PRICE and HIGH_PRICE
+std::vector<Workload_Order> make_orders(const int& count)
+{
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<int> side_dist(0, 1);
+    std::uniform_int_distribution<int> quantity_dist(1, 50);
+    std::uniform_int_distribution<int64_t> tick_dist(static_cast<int64_t>(LOW_PRICE * 100), static_cast<int64_t>(HIGH_PRICE * 100));
+    std::uniform_int_distribution<int> client_dist(1, 100);
+    std::vector<Workload_Order> orders(count);
+    for (auto& order : orders){
+        order = {side_dist(gen) == 0, quantity_dist(gen), tick_dist(gen), client_dist(gen)};
+    }
+    return orders;
+}
+
+double elapsed_since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// ---------------- Per-Price Rescan ----------------
+// equilibrium found by summing the demand and the supply of every candidate price over all the orders : O(prices x orders)
+int64_t rescan_volume(const std::vector<Workload_Order>& orders, const int64_t& low, const int64_t& high)
+{
+    int64_t best = 0;
+    for (int64_t tick = low; tick <= high; ++tick){
+        int64_t demand = 0;
+        int64_t supply = 0;
+        for (const auto& order : orders){
+            if (order.buy && order.tick >= tick){
+                demand += order.quantity;
+            }
+            else if (!order.buy && order.tick <= tick){
+                supply += order.quantity;
+            }
+        }
+        best = std::max(best, std::min(demand, supply));
+    }
+    return best;
+}
+
+
+// ---------------- Auction ----------------
+// accumulate the orders in PRE_OPEN, then time the equilibrium search and the uncross, false if the rescan finds another volume
+bool run(const std::vector<Workload_Order>& orders, const bool& with_rescan)
+{
+    Order_Book ob;
+    std::vector<Fill> fills;
+    ob.set_phase(Trading_Phase::PRE_CLOSE, fills);
+    ob.set_phase(Trading_Phase::CLOSE, fills);
+    ob.set_phase(Trading_Phase::PRE_OPEN, fills);
+    uint64_t order_id = 1;
+    for (const auto& order : orders){
+        ob.submit({order_id++, order.client_id, order.buy ? Side::BUY : Side::SELL, Order_Trigger::LIMIT, order.quantity, Price(order.tick), Price()}, fills);
+    }
+    int64_t low = ob.get_asks().get_best_tick();
+    int64_t high = ob.get_bids().get_best_tick();
+
+    // equilibrium only, the sweep once to warm the scratch array and then timed
+    ob.get_auction();
+    auto start = std::chrono::steady_clock::now();
+    Auction auction = ob.get_auction();
+    double sweep_seconds = elapsed_since(start);
+
+    double rescan_seconds = 0;
+    int64_t rescan = auction.volume;
+    if (with_rescan){
+        start = std::chrono::steady_clock::now();
+        rescan = rescan_volume(orders, low, high);
+        rescan_seconds = elapsed_since(start);
+    }
+
+    // uncross : the equilibrium then the fills of the crossing orders
+    start = std::chrono::steady_clock::now();
+    ob.set_phase(Trading_Phase::OPEN, fills);
+    double uncross_seconds = elapsed_since(start);
+
+    char rescan_text[32] = "-";
+    if (with_rescan){
+        snprintf(rescan_text, sizeof(rescan_text), "%.2f", rescan_seconds * 1e3);
+    }
+    printf("%10zu %8lld %14s %12.1f %12.2f %12lld %10zu\n", orders.size(), static_cast<long long>(high - low + 1), rescan_text,
+           sweep_seconds * 1e6, uncross_seconds * 1e3, static_cast<long long>(auction.volume), fills.size());
+    return rescan == auction.volume;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int max_count = (argc > 1) ? std::stoi(argv[1]) : DEFAULT_MAX_ORDERS;
+    if (max_count < 1000){
+        std::cerr << "Error: the number of orders must be at least 1000.\n";
+        return 1;
+    }
+    printf("Benchmark of the call auction (orders between %.2f and %.2f, up to %d orders)\n\n", LOW_PRICE, HIGH_PRICE, max_count);
+    printf("%10s %8s %14s %12s %12s %12s %10s\n", "orders", "ticks", "rescan (ms)", "sweep (us)", "uncross (ms)", "volume", "fills");
+
+    bool same = true;
+    for (int count = 1000; count <= max_count; count *= 10){
+        same = run(make_orders(count), count <= 100000) && same; // the rescan of 1 000 000 orders takes seconds
+    }
+    if (!same){
+        std::cerr << "Error: the sweep and the rescan found a different volume\n";
+        return 1;
+    }
+    printf("\nThe sweep and the rescan find the same executable volume.\n");
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "client.hpp"
+
+
+#define DATABASE_FILE "benchmark_profiles.db"
+#define CLIENT_COUNT 20
+#define ACTION_COUNT 10
+#define DEFAULT_ITERATIONS 500
+#define DISPLAY_RATIO 20 // one display for DISPLAY_RATIO orders, the portfolio query is CPU bound and would hide the I/O differences
+
+
+// one line of the benchmark matrix
+struct Profile_Result {
+    Database_Profile profile;
+    double order_per_s;
+    double settle_per_s;
+    double display_per_s;
+};
+
+// remove the database file and everything SQLite may have left next to it
+void remove_database_files()
+{
+    for (const std::string suffix : {"", "-journal", "-wal", "-shm"}){
+        std::filesystem::remove(DATABASE_FILE + suffix);
+    }
+}
+
+// elapsed seconds since start
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// fill a fresh database with clients, actions and one price per action
+void populate(Database_Manager& database)
+{
+    database.create_tables();
+    database.execute_SQL("BEGIN;");
+    for (int client_id = 1; client_id <= CLIENT_COUNT; ++client_id){
+        database.execute_SQL(fmt::format("INSERT INTO clients (client_id, name, encrypted_password, balance) VALUES ({}, 'client_{}', x'00', {})", client_id, client_id, 1000000LL * MONEY_SCALE));
+    }
+    for (int action_id = 1; action_id <= ACTION_COUNT; ++action_id){
+        database.execute_SQL(fmt::format("INSERT INTO actions (action_id, name, quantity) VALUES ({}, 'ACTION_{}', 1000000)", action_id, action_id));
+        database.execute_SQL(fmt::format("INSERT INTO prices (action_id, price, date_time, daily_time) VALUES ({}, 100.0, 0, 0)", action_id));
+    }
+    database.execute_SQL("COMMIT;");
+}
+
+// run the order / settle / display workload under a profile
+Profile_Result run_profile(const Database_Profile& profile, const int& iterations)
+{
+    remove_database_files();
+    Database_Manager database(DATABASE_FILE, profile);
+    populate(database);
+
+    std::mt19937 gen(42); // same workload for every profile
+    std::uniform_int_distribution<int> client_dist(1, CLIENT_COUNT);
+    std::uniform_int_distribution<int> action_dist(1, ACTION_COUNT);
+    std::uniform_real_distribution<double> price_dist(90.0, 110.0);
+
+    // order : every order is first stored as pending
+    std::vector<std::tuple<ID, ID, ID, double>> orders; // order_id, client_id, action_id, price
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i){
+        Client client(client_dist(gen), database);
+        ID order_id = database.get_new_order_id();
+        ID action_id = action_dist(gen);
+        double price = price_dist(gen);
+        client.add_pending_order(order_id, 0, i, Order_Type::BUY, 1, action_id, Order_Trigger::LIMIT, price, 0.0, 0.0, max_number, max_number);
+        orders.emplace_back(order_id, client.get_id(), action_id, price);
+    }
+    double order_time = seconds_since(start);
+
+    // settle : the pending order is filled, moved to the completed ones and the portfolio is updated
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i){
+        auto [order_id, client_id, action_id, price] = orders[i];
+        Client client(client_id, database);
+        client.remove_pending_order(order_id);
+        client.add_completed_order(order_id, 0, i, Order_Type::BUY, 1, action_id, Order_Trigger::LIMIT, price, 0.0, 0.0, max_number, max_number);
+        client.update_portfolio(Order_Type::BUY, action_id, 1, price, i, 0);
+    }
+    double settle_time = seconds_since(start);
+
+    // display : what a client refreshes in its interface
+    start = std::chrono::steady_clock::now();
+    size_t payload_size = 0;
+    int displays = std::max(1, iterations / DISPLAY_RATIO);
+    for (int i = 0; i < displays; ++i){
+        Client client(client_dist(gen), database);
+        payload_size += client.get_portfolio_info().size();
+        payload_size += client.get_completed_orders_info().size();
+    }
+    double display_time = seconds_since(start);
+    if (payload_size == 0){
+        std::cerr << "Error: empty display payloads\n";
+    }
+
+    database.close_database();
+    remove_database_files();
+    return {profile, iterations / order_time, iterations / settle_time, displays / display_time};
+}
+
+// what each profile guarantees after a crash
+std::string durability_of(const Database_Profile& profile)
+{
+    switch (profile){
+        case Database_Profile::DURABLE:
+            return "no committed transaction lost";
+        case Database_Profile::BALANCED:
+            return "last commits lost on power failure";
+        case Database_Profile::SIMULATION:
+            return "file may be corrupted on crash";
+        default:
+            return "no committed transaction lost";
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : DEFAULT_ITERATIONS;
+    std::cout << "Benchmark of the tuning profiles (" << iterations << " orders and settlements, " << std::max(1, iterations / DISPLAY_RATIO) << " displays per profile)\n\n";
+
+    std::vector<Profile_Result> results;
+    for (const Database_Profile profile : {Database_Profile::SQLITE_DEFAULT, Database_Profile::DURABLE, Database_Profile::BALANCED, Database_Profile::SIMULATION}){
+        results.push_back(run_profile(profile, iterations));
+    }
+
+    std::cout << fmt::format("{:<12} {:>12} {:>12} {:>12}   {}\n", "profile", "order/s", "settle/s", "display/s", "durability");
+    for (const Profile_Result& result : results){
+        std::cout << fmt::format("{:<12} {:>12.0f} {:>12.0f} {:>12.0f}   {}\n",
+            database_profile_to_string(result.profile),
+            result.order_per_s,
+            result.settle_per_s,
+            result.display_per_s,
+            durability_of(result.profile)
+        );
+    }
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "matching_engine.hpp"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+
+
+#define DEFAULT_ORDERS 400000
+#define PRODUCER_COUNT 8
+#define PACED_RATE 100000 // orders per second offered by all the order-entry threads of a paced run
+#define SEED 42
+
+
+using Clock = std::chrono::steady_clock;
+
+// nanoseconds since the start of the benchmark
+int64_t now_ns(const Clock::time_point& origin)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+}
+
+// a paced run submits order i at i / rate seconds (open loop), a saturated run (rate 0) as fast as it can
+void wait_turn(const Clock::time_point& origin, const size_t& i, const int& rate)
+{
+    if (rate > 0){
+        std::this_thread::sleep_until(origin + std::chrono::nanoseconds(static_cast<int64_t>(i * 1e9 / rate)));
+    }
+}
+
+
+// ---------------- Workload ----------------
+struct Workload_Order {
+    bool buy;
+    int quantity;
+    Price price; // in cents, the default tick size
+    int symbol; // index in the symbol list
+};
+
+// orders of the stress test (1 to 50 shares, a price between 90 and 160), spread over the first symbol_count symbols
+std::vector<Workload_Order> make_orders(const int& count, const int& symbol_count)
+{
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<int> side_dist(0, 1);
+    std::uniform_int_distribution<int> quantity_dist(1, 50);
+    std::uniform_int_distribution<int> cents_dist(9000, 16000);
+    std::uniform_int_distribution<int> symbol_dist(0, symbol_count - 1);
+    std::vector<Workload_Order> orders(count);
+    for (auto& order : orders){
+        order = {side_dist(gen) == 0, quantity_dist(gen), Price(cents_dist(gen)), symbol_dist(gen)};
+    }
+    return orders;
+}
+
+const std::vector<std::string> SYMBOLS = {"AAPL", "MSFT", "GOOG", "TSLA", "AMZN", "META", "NVDA", "NFLX"};
+
+struct Result {
+    double seconds;
+    std::vector<int64_t> latencies; // submission to end of matching, per order
+    long long volume;
+};
+
+
+// ---------------- Mutex Model ----------------
+// the former server : each order-entry thread locks the book of the symbol and matches the order itself
+Result run_mutex_model(const std::vector<Workload_Order>& orders, const int& producer_count, const int& rate)
+{
+    Result result{0, std::vector<int64_t>(orders.size()), 0};
+    std::map<std::string, Order_Book> market;
+    std::map<std::string, std::shared_mutex> market_mutexes;
+    for (const auto& symbol : SYMBOLS){
+        market[symbol];
+        market_mutexes[symbol];
+    }
+    std::atomic<long long> volume{0};
+
+    Clock::time_point origin = Clock::now();
+    std::vector<std::thread> producers;
+    for (int p = 0; p < producer_count; ++p){
+        producers.emplace_back([&, p]{
+            std::vector<Fill> fills;
+            long long traded = 0;
+            for (size_t i = p; i < orders.size(); i += producer_count){
+                const Workload_Order& order = orders[i];
+                wait_turn(origin, i, rate);
+                int64_t start = now_ns(origin);
+                {
+                    const std::string& symbol = SYMBOLS[order.symbol];
+                    std::unique_lock<std::shared_mutex> lock(market_mutexes[symbol]);
+                    fills.clear();
+                    market[symbol].submit({i + 1, p, order.buy ? Side::BUY : Side::SELL, Order_Trigger::LIMIT, order.quantity, order.price, Price()}, fills);
+                    for (const Fill& fill : fills){
+                        traded += fill.quantity;
+                    }
+                }
+                result.latencies[i] = now_ns(origin) - start;
+            }
+            volume += traded;
+        });
+    }
+    for (auto& producer : producers){
+        producer.join();
+    }
+    result.seconds = now_ns(origin) / 1e9;
+    result.volume = volume;
+    return result;
+}
+
+
+// ---------------- Sequencer Model ----------------
+// the order-entry threads hand the orders to the matching threads through the rings and go on at once
+Result run_sequencer_model(const std::vector<Workload_Order>& orders, const int& producer_count, const int& rate)
+{
+    Result result{0, std::vector<int64_t>(orders.size()), 0};
+    std::vector<int64_t> submitted(orders.size());
+    long long volume = 0; // the handler runs on every matching thread
+    std::mutex volume_mutex;
+    Symbol_Registry symbols; // listed in the order of SYMBOLS : the id of a symbol is its index
+    for (const auto& symbol : SYMBOLS){
+        symbols.add(symbol);
+    }
+
+    Clock::time_point origin = Clock::now();
+    {
+        Matching_Engine engine([&](const Engine_Command& command, const Engine_Result& engine_result){
+            size_t i = command.order_id - 1;
+            result.latencies[i] = now_ns(origin) - submitted[i];
+            if (!engine_result.fills.empty()){
+                long long traded = 0;
+                for (const Fill& fill : engine_result.fills){
+                    traded += fill.quantity;
+                }
+                std::lock_guard<std::mutex> lock(volume_mutex);
+                volume += traded;
+            }
+        }, symbols);
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < producer_count; ++p){
+            producers.emplace_back([&, p]{
+                for (size_t i = p; i < orders.size(); i += producer_count){
+                    const Workload_Order& order = orders[i];
+                    wait_turn(origin, i, rate);
+                    submitted[i] = now_ns(origin); // published to the matching thread by the ring
+                    engine.submit(Engine_Command{Command_Type::NEW, p, i + 1, order.buy ? Side::BUY : Side::SELL, Order_Trigger::LIMIT, order.quantity, order.price, Price(), 0, Symbol_Id(order.symbol)});
+                }
+            });
+        }
+        for (auto& producer : producers){
+            producer.join();
+        }
+    } // the engine processes what is queued before stopping
+    result.seconds = now_ns(origin) / 1e9;
+    result.volume = volume;
+    return result;
+}
+
+
+// ---------------- Report ----------------
+int64_t percentile(const std::vector<int64_t>& sorted, const double& fraction)
+{
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))];
+}
+
+void print_result(const std::string& workload, const std::string& model, Result result)
+{
+    std::sort(result.latencies.begin(), result.latencies.end());
+    printf("%-12s %-10s %12.0f %10.1f %10.1f %10.1f\n", workload.c_str(), model.c_str(), result.latencies.size() / result.seconds,
+        percentile(result.latencies, 0.50) / 1000.0, percentile(result.latencies, 0.99) / 1000.0, percentile(result.latencies, 0.999) / 1000.0);
+}
+
+
+int main(int argc, char* argv[])
+{
+    int count = (argc > 1) ? std::stoi(argv[1]) : DEFAULT_ORDERS;
+    if (count <= 0){
+        std::cerr << "Error: the number of orders must be positive.\n";
+        return 1;
+    }
+    printf("Benchmark of the matching models (%d order-entry threads, %u cores)\n\n", PRODUCER_COUNT, std::thread::hardware_concurrency());
+    bool same = true;
+    for (int rate : {0, PACED_RATE}){
+        if (rate == 0){
+            printf("Saturated : every thread submits as fast as it can (throughput, the latency is mostly queueing)\n");
+        }
+        else {
+            printf("\nPaced : %d orders per second offered in total (latency)\n", rate);
+        }
+        printf("%-12s %-10s %12s %10s %10s %10s\n", "workload", "model", "orders/s", "p50 (us)", "p99 (us)", "p99.9 (us)");
+        for (int symbol_count : {1, 8}){
+            // a paced run lasts about one second
+            std::vector<Workload_Order> orders = make_orders((rate == 0) ? count : std::min(count, rate), symbol_count);
+            std::string workload = (symbol_count == 1) ? "1 symbol" : std::to_string(symbol_count) + " symbols";
+            Result mutex_result = run_mutex_model(orders, PRODUCER_COUNT, rate);
+            Result sequencer_result = run_sequencer_model(orders, PRODUCER_COUNT, rate);
+            print_result(workload, "mutex", mutex_result);
+            print_result("", "sequencer", sequencer_result);
+            same = same && mutex_result.volume > 0 && sequencer_result.volume > 0;
+        }
+    }
+    if (!same){
+        std::cerr << "Error: a model traded nothing\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,287 @@
+#include "order_book.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <queue>
+#include <random>
+#include <string>
+
+
+#define DEFAULT_ORDERS 1000000
+#define SEED 42
+#define CANCEL_LAG 2 // the churn cancels the order sent that many orders before
+
+
+// ---------------- Allocation counter ----------------
+// every operator new of the program goes through these, so a run can tell how many times it called malloc
+static size_t Allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    ++Allocations;
+    if (void* memory = std::malloc(size ? size : 1)){
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    ++Allocations;
+    size_t align = static_cast<size_t>(alignment);
+    if (void* memory = std::aligned_alloc(align, (size + align - 1) / align * align)){
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+
+// ---------------- Former Order Book ----------------
+// the priority_queue book of Engine_Mutex before the price levels, kept here for the comparison
+struct Order {
+    std::string type;        // BUY or SELL
+    int quantity;
+    std::string symbol;      // e.g. "AAPL"
+    std::string order_type;  // LIMIT for now
+    double price;
+    int client_id;           // to know who sent it
+};
+
+struct OrderCompareBuy {
+    bool operator()(const Order& a, const Order& b)
+    {
+        return a.price < b.price; // highest price first
+    }
+};
+struct OrderCompareSell {
+    bool operator()(const Order& a, const Order& b)
+    {
+        return a.price > b.price; // lowest price first
+    }
+};
+
+// former trade, priced in double
+struct Former_Fill {
+    int buyer;
+    int seller;
+    int quantity;
+    double price;
+};
+
+struct OrderBook {
+    std::priority_queue<Order, std::vector<Order>, OrderCompareBuy> buyOrders;
+    std::priority_queue<Order, std::vector<Order>, OrderCompareSell> sellOrders;
+};
+
+// former process_order, the trades are appended instead of settled
+void process_order(OrderBook& ob, Order o, std::vector<Former_Fill>& fills)
+{
+    if (o.type == "BUY"){
+        while (!ob.sellOrders.empty() && ob.sellOrders.top().price <= o.price && o.quantity > 0){
+            Order sell = ob.sellOrders.top();
+            ob.sellOrders.pop();
+            int tradedQty = std::min(o.quantity, sell.quantity);
+            fills.push_back({o.client_id, sell.client_id, tradedQty, sell.price});
+            o.quantity -= tradedQty;
+            sell.quantity -= tradedQty;
+            if (sell.quantity > 0){
+                ob.sellOrders.push(sell);
+            }
+        }
+        if (o.quantity > 0){
+            ob.buyOrders.push(o);
+        }
+    }
+    else {
+        while (!ob.buyOrders.empty() && ob.buyOrders.top().price >= o.price && o.quantity > 0){
+            Order buy = ob.buyOrders.top();
+            ob.buyOrders.pop();
+            int tradedQty = std::min(o.quantity, buy.quantity);
+            fills.push_back({buy.client_id, o.client_id, tradedQty, buy.price});
+            o.quantity -= tradedQty;
+            buy.quantity -= tradedQty;
+            if (buy.quantity > 0){
+                ob.buyOrders.push(buy);
+            }
+        }
+        if (o.quantity > 0){
+            ob.sellOrders.push(o);
+        }
+    }
+}
+
+
+// ---------------- Workloads ----------------
+struct Workload_Order {
+    bool buy;
+    int quantity;
+    double price; // for the former book
+    Price tick; // for the new one (tick size 0.01)
+    int client_id;
+};
+
+struct Result {
+    double seconds;
+    long long volume;   // sum of the traded quantities
+    long long notional; // sum of quantity x price, in cents
+    size_t fills;
+    size_t resting;     // orders left in the book
+    size_t allocations; // calls to operator new during the run
+};
+
+// the orders of the stress test : random side, 1 to 50 shares, a price with 2 decimals between low and high
+std::vector<Workload_Order> make_orders(const int& count, const double& low, const double& high)
+{
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<int> side_dist(0, 1);
+    std::uniform_int_distribution<int> quantity_dist(1, 50);
+    std::uniform_int_distribution<int> cents_dist(static_cast<int>(low * 100), static_cast<int>(high * 100));
+    std::uniform_int_distribution<int> client_dist(1, 100);
+    std::vector<Workload_Order> orders(count);
+    for (auto& order : orders){
+        bool buy = side_dist(gen) == 0;
+        int quantity = quantity_dist(gen);
+        int cents = cents_dist(gen);
+        order = {buy, quantity, cents / 100.0, Price(cents), client_dist(gen)};
+    }
+    return orders;
+}
+
+void add_fills(Result& result, const std::vector<Former_Fill>& fills)
+{
+    for (const Former_Fill& fill : fills){
+        result.volume += fill.quantity;
+        result.notional += std::llround(fill.price * 100) * fill.quantity;
+    }
+    result.fills += fills.size();
+}
+
+void add_fills(Result& result, const std::vector<Fill>& fills)
+{
+    for (const Fill& fill : fills){
+        result.volume += fill.quantity;
+        result.notional += fill.price.get_ticks() * fill.quantity; // a tick is a cent
+    }
+    result.fills += fills.size();
+}
+
+Result run_priority_queue(const std::vector<Workload_Order>& orders)
+{
+    Result result{};
+    OrderBook ob;
+    std::vector<Former_Fill> fills;
+    size_t allocations = Allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& order : orders){
+        fills.clear();
+        process_order(ob, Order{order.buy ? "BUY" : "SELL", order.quantity, "AAPL", "LIMIT", order.price, order.client_id}, fills);
+        add_fills(result, fills);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.allocations = Allocations - allocations;
+    result.resting = ob.buyOrders.size() + ob.sellOrders.size();
+    return result;
+}
+
+Result run_price_levels(const std::vector<Workload_Order>& orders)
+{
+    Result result{};
+    Order_Book ob;
+    std::vector<Fill> fills;
+    uint64_t order_id = 1;
+    size_t allocations = Allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& order : orders){
+        fills.clear();
+        ob.submit({order_id++, order.client_id, order.buy ? Side::BUY : Side::SELL, Order_Trigger::LIMIT, order.quantity, order.tick, Price()}, fills);
+        add_fills(result, fills);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.allocations = Allocations - allocations;
+    result.resting = ob.get_bids().get_order_count() + ob.get_asks().get_order_count();
+    return result;
+}
+
+// one pass of add, fill and cancel on a book : each order is sent, then the one sent CANCEL_LAG orders before is cancelled if it still rests,
+// and what is left is cancelled at the end, so the book is empty again, the ids start at first_id
+void churn(Order_Book& ob, const std::vector<Workload_Order>& orders, const uint64_t& first_id, std::vector<Fill>& fills)
+{
+    for (size_t i = 0; i < orders.size(); ++i){
+        const Workload_Order& order = orders[i];
+        fills.clear();
+        ob.submit({first_id + i, order.client_id, order.buy ? Side::BUY : Side::SELL, Order_Trigger::LIMIT, order.quantity, order.tick, Price()}, fills);
+        if (i >= CANCEL_LAG){
+            ob.cancel(first_id + i - CANCEL_LAG);
+        }
+    }
+    for (size_t i = 0; i < orders.size(); ++i){
+        ob.cancel(first_id + i);
+    }
+}
+
+// the same churn twice on one book : the first pass warms the pools up, the second one goes through the same depths and must not allocate
+bool steady_state(const std::vector<Workload_Order>& orders)
+{
+    Order_Book ob;
+    std::vector<Fill> fills;
+    fills.reserve(1024);
+    size_t allocations = Allocations;
+    churn(ob, orders, 1, fills);
+    size_t warm_up = Allocations - allocations;
+    allocations = Allocations;
+    auto start = std::chrono::steady_clock::now();
+    churn(ob, orders, orders.size() + 1, fills);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t steady = Allocations - allocations;
+    printf("%-26s %12zu %12zu %14.0f\n", "price levels", warm_up, steady, orders.size() / seconds);
+    return steady == 0;
+}
+
+// runs both books on the same orders, false if they traded differently
+bool compare(const std::string& name, const std::vector<Workload_Order>& orders)
+{
+    Result former = run_priority_queue(orders);
+    Result levels = run_price_levels(orders);
+    size_t count = orders.size();
+    printf("%-26s %-16s %12.0f %10s %10zu %10zu %12zu\n", name.c_str(), "priority_queue", count / former.seconds, "1.0x", former.fills, former.resting, former.allocations);
+    printf("%-26s %-16s %12.0f %9.1fx %10zu %10zu %12zu\n", "", "price levels", count / levels.seconds, former.seconds / levels.seconds, levels.fills, levels.resting, levels.allocations);
+    // prices only decide what trades : the volume and the notional are the same, the counterparties within a level may differ
+    return former.volume == levels.volume && former.notional == levels.notional;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int count = (argc > 1) ? std::stoi(argv[1]) : DEFAULT_ORDERS;
+    if (count <= 0){
+        std::cerr << "Error: the number of orders must be positive.\n";
+        return 1;
+    }
+    printf("Benchmark of the order book (%d orders per workload)\n\n", count);
+    printf("%-26s %-16s %12s %10s %10s %10s %12s\n", "workload", "book", "orders/s", "speedup", "fills", "resting", "allocations");
+
+    bool same = compare("wide (90 - 160)", make_orders(count, 90.0, 160.0));
+    same = compare("narrow (124.50 - 125.50)", make_orders(count, 124.5, 125.5)) && same;
+    if (!same){
+        std::cerr << "Error: the books traded a different volume\n";
+        return 1;
+    }
+    printf("\nBoth books trade the same volume and notional on every workload.\n");
+
+    // add, fill and cancel : once warmed up, the price levels book must not call malloc
+    printf("\nAllocations of the price levels book, add / fill / cancel churn on the wide workload\n\n");
+    printf("%-26s %12s %12s %14s\n", "book", "warm-up", "steady", "orders/s");
+    if (!steady_state(make_orders(count, 90.0, 160.0))){
+        std::cerr << "Error: the book allocated after its warm-up\n";
+        return 1;
+    }
+    printf("\nNo allocation once the book is warmed up.\n");
+    return 0;
+}
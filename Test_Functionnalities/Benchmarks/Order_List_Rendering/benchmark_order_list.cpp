@@ -0,0 +1,173 @@
+#include "client.hpp"
+
+
+#define DATABASE_FILE "benchmark_order_list.db"
+#define CLIENT_ID 1
+#define ACTION_COUNT 10
+#define DEFAULT_ROWS 1000000
+
+
+// remove the database file and everything SQLite may have left next to it
+void remove_database_files()
+{
+    for (const std::string suffix : {"", "-journal", "-wal", "-shm"}){
+        std::filesystem::remove(DATABASE_FILE + suffix);
+    }
+}
+
+// elapsed seconds since start
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// one client with a history of completed orders, inserted with a prepared statement in one transaction
+void populate(Database_Manager& database, const int& rows)
+{
+    database.create_tables();
+    database.execute_SQL("BEGIN;");
+    database.execute_SQL(fmt::format("INSERT INTO clients (client_id, name, encrypted_password, balance) VALUES ({}, 'client', x'00', {})", CLIENT_ID, 1000000LL * MONEY_SCALE));
+    for (int action_id = 1; action_id <= ACTION_COUNT; ++action_id){
+        database.execute_SQL(fmt::format("INSERT INTO actions (action_id, name, quantity) VALUES ({}, 'ACTION_{}', 1000000)", action_id, action_id));
+    }
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(database.get_database(), "INSERT INTO orders (order_id, order_status, order_time_date, order_time_daily, client_id, order_type, quantity, action_id, trigger_type, price, trigger_price_lower, trigger_price_upper, expiration_time_date, expiration_time_daily) VALUES (?, 'COMPLETED', ?, ?, ?, ?, ?, ?, 'LIMIT', ?, 0.0, 0.0, ?, ?)", -1, &stmt, nullptr);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> daily_dist(0, MS_IN_H * 24 - 1);
+    std::uniform_int_distribution<int> action_dist(1, ACTION_COUNT);
+    std::uniform_int_distribution<int> quantity_dist(1, 1000);
+    std::uniform_real_distribution<double> price_dist(10.0, 1000.0);
+    ID first_date = get_date_id_from_string("2025-01-01");
+    for (int i = 1; i <= rows; ++i){
+        sqlite3_bind_int64(stmt, 1, i);
+        sqlite3_bind_int64(stmt, 2, first_date + i / 5000); // 5000 orders a day
+        sqlite3_bind_int64(stmt, 3, daily_dist(gen));
+        sqlite3_bind_int64(stmt, 4, CLIENT_ID);
+        sqlite3_bind_text(stmt, 5, (i % 2) ? "BUY" : "SELL", -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 6, quantity_dist(gen));
+        sqlite3_bind_int64(stmt, 7, action_dist(gen));
+        sqlite3_bind_double(stmt, 8, std::round(price_dist(gen) * 100) / 100);
+        sqlite3_bind_int64(stmt, 9, max_number);
+        sqlite3_bind_int64(stmt, 10, max_number);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    database.execute_SQL("COMMIT;");
+}
+
+// the former rendering : every row copied into strings, then one fmt::format temporary and two two_times_to_string per row
+std::string render_legacy(Database_Manager& database, const std::string& query)
+{
+    std::vector<std::vector<std::string>> orders_info = database.execute_SQL_query_vec_strings(query);
+    std::string result;
+    for (const auto& order : orders_info){
+        if (order.size() >= 12){
+            result += fmt::format(
+                "{} {} {} {} {} {} {} {} {} {},",
+                two_times_to_string(std::stoll(order[0]), std::stoll(order[1])),
+                order[2],
+                order[3],
+                order[4],
+                order[5],
+                order[6],
+                order[7],
+                order[8],
+                order[9],
+                two_times_to_string(std::stoll(order[10]), std::stoll(order[11]))
+            );
+        }
+    }
+    if (!result.empty()){
+        result.pop_back(); // remove trailing comma
+    }
+    return result;
+}
+
+// print one line of the result table
+void print_line(const std::string& name, const double& rows, const double& seconds, const double& reference)
+{
+    fmt::print("{:<36} {:>14.0f} {:>9.1f}x\n", name, rows / seconds, reference / seconds);
+}
+
+
+int main(int argc, char* argv[])
+{
+    int rows = (argc > 1) ? std::stoi(argv[1]) : DEFAULT_ROWS;
+    if (rows <= 0){
+        std::cerr << "Error: the number of rows must be positive.\n";
+        return 1;
+    }
+    remove_database_files();
+    Database_Manager database(DATABASE_FILE, Database_Profile::BALANCED);
+    populate(database, rows);
+    Client client(CLIENT_ID, database);
+
+    std::string query = fmt::format(
+        R"(SELECT {}
+          FROM orders o JOIN actions a ON o.action_id = a.action_id JOIN clients c ON o.client_id = c.client_id
+          WHERE o.client_id = {} AND o.order_status = 'COMPLETED')",
+        ORDER_LIST_COLUMNS,
+        CLIENT_ID
+    );
+    fmt::print("Benchmark of the order list rendering ({} completed orders of one client)\n\n", rows);
+    fmt::print("{:<36} {:>14} {:>10}\n", "rendering", "rows/s", "speedup");
+
+    // time formatting alone
+    std::vector<std::pair<ID, ID>> times;
+    database.execute_SQL_query_rows_view("SELECT order_time_date, order_time_daily FROM orders", [&times](sqlite3_stmt* stmt){
+        times.emplace_back(sqlite3_column_int64(stmt, 0), sqlite3_column_int64(stmt, 1));
+    });
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& [date_time, daily_time] : times){
+        checksum += two_times_to_string(date_time, daily_time).size();
+    }
+    double snprintf_time = seconds_since(start);
+    fmt::memory_buffer buffer;
+    start = std::chrono::steady_clock::now();
+    for (const auto& [date_time, daily_time] : times){
+        buffer.clear();
+        format_two_times(buffer, date_time, daily_time);
+        checksum += buffer.size();
+    }
+    double table_time = seconds_since(start);
+    print_line("two_times_to_string (snprintf)", rows, snprintf_time, snprintf_time);
+    print_line("format_two_times (lookup table)", rows, table_time, snprintf_time);
+    fmt::print("\n");
+
+    // whole list : query and formatting
+    start = std::chrono::steady_clock::now();
+    std::string legacy = render_legacy(database, query);
+    double legacy_time = seconds_since(start);
+
+    Order_List_Renderer renderer;
+    start = std::chrono::steady_clock::now();
+    renderer.render(database, query);
+    double renderer_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    renderer.clear(); // second rendering in the same buffer : no reallocation
+    renderer.render(database, query);
+    double reused_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    std::string paged = client.get_completed_orders_info();
+    double paged_time = seconds_since(start);
+
+    print_line("vector of strings + fmt::format", rows, legacy_time, legacy_time);
+    print_line("Order_List_Renderer", rows, renderer_time, legacy_time);
+    print_line("Order_List_Renderer, reused buffer", rows, reused_time, legacy_time);
+    print_line("get_completed_orders_info (paged)", rows, paged_time, legacy_time);
+
+    // every rendering gives the same payload (the paged one is sorted by time)
+    if (legacy != renderer.view() || legacy.size() != paged.size()){
+        std::cerr << "Error: the renderings differ\n";
+        return 1;
+    }
+    fmt::print("\n{} bytes rendered per list (checksum {})\n", legacy.size(), checksum);
+
+    database.close_database();
+    remove_database_files();
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "client.hpp"
+#include "settlement_batch.hpp"
+
+
+#define DATABASE_FILE "benchmark_settlement_batch.db"
+#define CLIENT_COUNT 100
+#define ACTION_COUNT 20
+#define DEFAULT_FILLS 20000
+
+
+// remove the database file and everything SQLite may have left next to it
+void remove_database_files()
+{
+    for (const std::string suffix : {"", "-journal", "-wal", "-shm"}){
+        std::filesystem::remove(DATABASE_FILE + suffix);
+    }
+}
+
+// elapsed seconds since start
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// fill a fresh database with rich clients holding every action, and one price per action
+void populate(Database_Manager& database)
+{
+    database.create_tables();
+    database.execute_SQL("BEGIN;");
+    for (int client_id = 1; client_id <= CLIENT_COUNT; ++client_id){
+        database.execute_SQL(fmt::format("INSERT INTO clients (client_id, name, encrypted_password, balance) VALUES ({}, 'client_{}', x'00', {})", client_id, client_id, 100000000LL * MONEY_SCALE));
+    }
+    for (int action_id = 1; action_id <= ACTION_COUNT; ++action_id){
+        database.execute_SQL(fmt::format("INSERT INTO actions (action_id, name, quantity) VALUES ({}, 'ACTION_{}', 1000000)", action_id, action_id));
+        database.execute_SQL(fmt::format("INSERT INTO prices (action_id, price, date_time, daily_time) VALUES ({}, 100.0, 0, 0)", action_id));
+        for (int client_id = 1; client_id <= CLIENT_COUNT; ++client_id){
+            database.execute_SQL(fmt::format("INSERT INTO client_portfolio (client_id, action_id, quantity) VALUES ({}, {}, 1000000)", client_id, action_id));
+        }
+    }
+    database.execute_SQL("COMMIT;");
+}
+
+// same random fills for every run : one buying and one selling leg per trade
+std::vector<Settlement_Fill> generate_fills(const int& count)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> client_dist(1, CLIENT_COUNT);
+    std::uniform_int_distribution<int> action_dist(1, ACTION_COUNT);
+    std::uniform_int_distribution<int> quantity_dist(1, 100);
+    std::uniform_real_distribution<double> price_dist(90.0, 110.0);
+
+    std::vector<Settlement_Fill> fills;
+    for (int i = 0; i + 1 < count; i += 2){
+        ID action_id = action_dist(gen);
+        int quantity = quantity_dist(gen);
+        Price price = price_from_double(price_dist(gen), MONEY_TICK_SIZE);
+        fills.push_back({client_dist(gen), Order_Type::BUY, action_id, quantity, price, i, 0});
+        fills.push_back({client_dist(gen), Order_Type::SELL, action_id, quantity, price, i, 0});
+    }
+    return fills;
+}
+
+// fills per second, settled one by one with Client::update_portfolio (batch_size = 0) or by batches of batch_size
+double run(const std::vector<Settlement_Fill>& fills, const size_t& batch_size)
+{
+    remove_database_files();
+    Database_Manager database(DATABASE_FILE, Database_Profile::BALANCED);
+    populate(database);
+    database.enable_price_aggregation(); // the price rows are written in batches in both modes, only the settlement is compared
+
+    auto start = std::chrono::steady_clock::now();
+    if (batch_size == 0){
+        for (const Settlement_Fill& fill : fills){
+            Client client(fill.client_id, database);
+            client.update_portfolio(fill.order_type, fill.action_id, fill.quantity, price_to_double(fill.price, MONEY_TICK_SIZE), fill.daily_time, fill.date_time);
+        }
+    }
+    else {
+        Settlement_Batch batch(database);
+        for (const Settlement_Fill& fill : fills){
+            batch.add_fill(fill.client_id, fill.order_type, fill.action_id, fill.quantity, fill.price, fill.daily_time, fill.date_time);
+            if (batch.size() >= batch_size){
+                batch.apply();
+            }
+        }
+        batch.apply();
+    }
+    database.flush_price_ticks();
+    double elapsed = seconds_since(start);
+    database.close_database();
+    return fills.size() / elapsed;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int fill_count = (argc > 1) ? std::stoi(argv[1]) : DEFAULT_FILLS;
+    if (fill_count <= 1){
+        std::cerr << "Error: the number of fills must be greater than 1.\n";
+        return 1;
+    }
+    std::vector<Settlement_Fill> fills = generate_fills(fill_count);
+
+    fmt::print("Benchmark of the settlement ({} fills, {} clients, {} actions, balanced profile)\n\n", fills.size(), CLIENT_COUNT, ACTION_COUNT);
+    fmt::print("{:<20} {:>12} {:>10}\n", "mode", "fills/s", "speedup");
+
+    double single = run(fills, 0);
+    fmt::print("{:<20} {:>12.0f} {:>9.1f}x\n", "update_portfolio", single, 1.0);
+    for (const size_t batch_size : {1, 10, 100, 1000, 10000}){
+        if (batch_size > fills.size()){
+            break;
+        }
+        double rate = run(fills, batch_size);
+        fmt::print("{:<20} {:>12.0f} {:>9.1f}x\n", fmt::format("batch of {}", batch_size), rate, rate / single);
+    }
+
+    remove_database_files();
+    return 0;
+}
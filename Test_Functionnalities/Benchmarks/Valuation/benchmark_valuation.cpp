@@ -0,0 +1,171 @@
+#include "client.hpp"
+#include "valuation_engine.hpp"
+
+
+#define DATABASE_FILE "benchmark_valuation.db"
+#define DEFAULT_CLIENTS 100000
+#define DEFAULT_POSITIONS_PER_CLIENT 5
+#define ACTION_COUNT 100
+#define ROUNDS 20 // valuations per thread count, the best one is reported
+#define CHECK_STEP 1000 // one client out of CHECK_STEP is checked against Client::get_portfolio_info
+
+
+// remove the database file and everything SQLite may have left next to it
+void remove_database_files()
+{
+    for (const std::string suffix : {"", "-journal", "-wal", "-shm"}){
+        std::filesystem::remove(DATABASE_FILE + suffix);
+    }
+}
+
+// elapsed seconds since start
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// run a prepared statement with its bound values, then reset it for the next row
+void step(sqlite3_stmt* stmt)
+{
+    if (sqlite3_step(stmt) != SQLITE_DONE){
+        std::cerr << "Error: insertion failed.\n";
+        throw std::runtime_error("Insertion failed");
+    }
+    sqlite3_reset(stmt);
+}
+
+// fresh database : one price per action, clients holding positions_per_client distinct actions at random costs
+void populate(Database_Manager& database, const int& client_count, const int& positions_per_client)
+{
+    database.create_tables();
+    sqlite3* db = database.get_database();
+    sqlite3_stmt* client_stmt = nullptr;
+    sqlite3_stmt* position_stmt = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO clients (client_id, name, encrypted_password, balance) VALUES (?1, 'client_' || ?1, x'00', ?2)", -1, &client_stmt, nullptr);
+    sqlite3_prepare_v2(db, "INSERT INTO client_portfolio (client_id, action_id, quantity, average_cost, realized_pnl) VALUES (?1, ?2, ?3, ?4, ?5)", -1, &position_stmt, nullptr);
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> price_dist(10.0, 500.0);
+    std::uniform_real_distribution<double> balance_dist(0.0, 1000000.0);
+    std::uniform_int_distribution<int> quantity_dist(1, 1000);
+    std::uniform_int_distribution<int> first_action_dist(1, ACTION_COUNT);
+
+    database.execute_SQL("BEGIN;");
+    for (int action_id = 1; action_id <= ACTION_COUNT; ++action_id){
+        database.execute_SQL(fmt::format("INSERT INTO actions (action_id, name, quantity) VALUES ({}, 'ACTION_{}', 100000000)", action_id, action_id));
+        database.execute_SQL(fmt::format("INSERT INTO prices (action_id, price, date_time, daily_time) VALUES ({}, {}, 0, 0)", action_id, price_dist(gen)));
+    }
+    for (int client_id = 1; client_id <= client_count; ++client_id){
+        sqlite3_bind_int64(client_stmt, 1, client_id);
+        sqlite3_bind_int64(client_stmt, 2, money_from_double(balance_dist(gen))); // in money units
+        step(client_stmt);
+        int first_action = first_action_dist(gen);
+        for (int p = 0; p < positions_per_client; ++p){
+            sqlite3_bind_int64(position_stmt, 1, client_id);
+            sqlite3_bind_int64(position_stmt, 2, (first_action + p) % ACTION_COUNT + 1);
+            sqlite3_bind_int(position_stmt, 3, quantity_dist(gen));
+            sqlite3_bind_double(position_stmt, 4, price_dist(gen));
+            sqlite3_bind_double(position_stmt, 5, balance_dist(gen) / 100.0);
+            step(position_stmt);
+        }
+    }
+    database.execute_SQL("COMMIT;");
+    sqlite3_finalize(client_stmt);
+    sqlite3_finalize(position_stmt);
+}
+
+// true if the two values agree up to the rounding of a different summation order
+bool close_enough(const double& a, const double& b)
+{
+    return std::abs(a - b) <= 1e-9 * std::max({1.0, std::abs(a), std::abs(b)});
+}
+
+// compare the valuation of a client with its portfolio view : "value balance,name quantity price date time average_cost unrealized realized,..."
+bool check_client(Database_Manager& database, const Client_Valuation& valuation)
+{
+    Client client(valuation.client_id, database);
+    std::string info = client.get_portfolio_info();
+    std::istringstream entries(info);
+    std::string entry;
+    std::getline(entries, entry, ',');
+    std::istringstream header(entry);
+    double market_value = 0.0;
+    double balance = 0.0;
+    header >> market_value >> balance;
+
+    // the P&L are the last two fields of each holding
+    double unrealized_pnl = 0.0;
+    double realized_pnl = 0.0;
+    while (std::getline(entries, entry, ',')){
+        size_t realized_start = entry.rfind(' ');
+        size_t unrealized_start = entry.rfind(' ', realized_start - 1);
+        unrealized_pnl += std::stod(entry.substr(unrealized_start + 1, realized_start - unrealized_start - 1));
+        realized_pnl += std::stod(entry.substr(realized_start + 1));
+    }
+    return close_enough(market_value, valuation.market_value) && close_enough(balance, valuation.balance)
+        && close_enough(unrealized_pnl, valuation.unrealized_pnl) && close_enough(realized_pnl, valuation.realized_pnl);
+}
+
+
+int main(int argc, char* argv[])
+{
+    int client_count = (argc > 1) ? std::stoi(argv[1]) : DEFAULT_CLIENTS;
+    int positions_per_client = (argc > 2) ? std::stoi(argv[2]) : DEFAULT_POSITIONS_PER_CLIENT;
+    if (client_count <= 0 || positions_per_client < 0 || positions_per_client > ACTION_COUNT || (argc > 3 && std::stoi(argv[3]) <= 0)){
+        std::cerr << "Error: the numbers of clients and threads must be positive and the positions per client between 0 and " << ACTION_COUNT << ".\n";
+        return 1;
+    }
+
+    remove_database_files();
+    Database_Manager database(DATABASE_FILE, Database_Profile::BALANCED);
+    populate(database, client_count, positions_per_client);
+
+    size_t max_threads = (argc > 3) ? std::stoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> thread_counts = {1};
+    for (size_t threads = 2; threads < max_threads; threads *= 2){
+        thread_counts.push_back(threads);
+    }
+    if (max_threads > 1){
+        thread_counts.push_back(max_threads);
+    }
+
+    fmt::print("Benchmark of the valuation ({} clients, {} positions, {} actions, balanced profile)\n\n", client_count, client_count * positions_per_client, ACTION_COUNT);
+    Valuation_Engine snapshot_engine(database, 1);
+    auto start = std::chrono::steady_clock::now();
+    snapshot_engine.take_snapshot();
+    fmt::print("{:<20} {:>10.1f} ms\n\n", "snapshot", seconds_since(start) * 1e3);
+
+    fmt::print("{:<20} {:>13} {:>12} {:>10}\n", "valuation threads", "best", "clients/s", "speedup");
+    double single = 0.0;
+    std::vector<Client_Valuation> valuations;
+    for (const size_t threads : thread_counts){
+        Valuation_Engine engine(database, threads); // the workers start here, not in the timed valuations
+        engine.take_snapshot();
+        double best = std::numeric_limits<double>::max();
+        for (int round = 0; round < ROUNDS; ++round){
+            start = std::chrono::steady_clock::now();
+            valuations = engine.value_clients();
+            best = std::min(best, seconds_since(start));
+        }
+        if (threads == 1){
+            single = best;
+        }
+        fmt::print("{:<20} {:>10.2f} ms {:>12.0f} {:>9.1f}x\n", threads, best * 1e3, client_count / best, single / best);
+    }
+
+    // the parallel valuation gives the figures of the portfolio view
+    size_t checked = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < valuations.size(); i += CHECK_STEP){
+        ++checked;
+        if (!check_client(database, valuations[i])){
+            ++mismatches;
+            std::cerr << "Error: client " << valuations[i].client_id << " is valued differently by get_portfolio_info.\n";
+        }
+    }
+    fmt::print("\nchecked against get_portfolio_info: {} clients, {}\n", checked, (mismatches == 0) ? "OK" : "FAILED");
+
+    database.close_database();
+    remove_database_files();
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+#include "client.hpp"
+#include "settlement_batch.hpp"
+
+
+#define DATABASE_FILE "atomic_settlement.db"
+#define CLIENT_ID 1
+#define ACTION_ID 1
+#define INITIAL_BALANCE (1000 * MONEY_SCALE) // in money units
+#define INITIAL_SHARES 10
+#define PRICE (10 * MONEY_SCALE) // in money units, the ticks of a Price of the application
+#define DEFAULT_THREADS 64
+#define ORDERS_PER_THREAD 20
+#define RESERVED_ORDER_ID 1 // pending buy holding every fund of the client in the reservation run
+
+
+// counters of one run
+struct Run_Result {
+    int bought; // shares of the successful buys
+    int sold; // shares of the successful sells
+    Money memory_balance;
+    Money database_balance;
+    int memory_shares;
+    int database_shares;
+    Money lowest_balance; // lowest balance seen by the threads during the run
+};
+
+// remove the database file and everything SQLite may have left next to it
+void remove_database_files()
+{
+    for (const std::string suffix : {"", "-journal", "-wal", "-shm"}){
+        std::filesystem::remove(DATABASE_FILE + suffix);
+    }
+}
+
+// fresh database with one client, one action and one price
+void populate(Database_Manager& database)
+{
+    database.create_tables();
+    database.execute_SQL(fmt::format("INSERT INTO clients (client_id, name, encrypted_password, balance) VALUES ({}, 'client', x'00', {})", CLIENT_ID, INITIAL_BALANCE));
+    database.execute_SQL(fmt::format("INSERT INTO actions (action_id, name, quantity) VALUES ({}, 'ACTION', 1000000)", ACTION_ID));
+    database.execute_SQL(fmt::format("INSERT INTO prices (action_id, price, date_time, daily_time) VALUES ({}, {}, 0, 0)", ACTION_ID, money_to_double(PRICE)));
+    database.execute_SQL(fmt::format("INSERT INTO client_portfolio (client_id, action_id, quantity) VALUES ({}, {}, {})", CLIENT_ID, ACTION_ID, INITIAL_SHARES));
+}
+
+// every thread sends buy orders of 1 to 5 shares and a few sell orders against the same client
+// atomic = true : Account::settle (guarded UPDATE), atomic = false : the former check-then-act sequence of Client::update_portfolio
+Run_Result run(const int& threads, const bool& atomic)
+{
+    remove_database_files();
+    Database_Manager database(DATABASE_FILE, Database_Profile::BALANCED);
+    populate(database);
+
+    std::atomic<int> bought{0};
+    std::atomic<int> sold{0};
+    std::mutex lowest_mutex;
+    Money lowest_balance = INITIAL_BALANCE;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t){
+        workers.emplace_back([&, t](){
+            Client client(CLIENT_ID, database); // one handle per thread, the account behind it is shared (its API takes doubles)
+            double price = money_to_double(PRICE);
+            std::shared_ptr<Account> account = database.get_account(CLIENT_ID);
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<int> quantity_dist(1, 5);
+            for (int i = 0; i < ORDERS_PER_THREAD; ++i){
+                int quantity = quantity_dist(gen);
+                Order_Type order_type = (i % 4 == 3) ? Order_Type::SELL : Order_Type::BUY;
+                bool done = false;
+                if (atomic){
+                    done = account->settle(order_type, ACTION_ID, quantity, Price(PRICE));
+                }
+                else if (order_type == Order_Type::BUY && client.can_afford(quantity, price, ACTION_ID)){
+                    std::this_thread::yield(); // widen the window between the check and the write
+                    client.withdraw(price * quantity);
+                    client.add_action(ACTION_ID, quantity, price, i, 0);
+                    done = true;
+                }
+                else if (order_type == Order_Type::SELL && client.has_shares(ACTION_ID, quantity)){
+                    std::this_thread::yield();
+                    client.deposit(price * quantity);
+                    client.remove_action(ACTION_ID, quantity, price, i, 0);
+                    done = true;
+                }
+                if (done){
+                    (order_type == Order_Type::BUY ? bought : sold) += quantity;
+                }
+                Money balance = account->get_balance();
+                std::lock_guard<std::mutex> lock(lowest_mutex);
+                lowest_balance = std::min(lowest_balance, balance);
+            }
+        });
+    }
+    for (auto& worker : workers){
+        worker.join();
+    }
+
+    std::shared_ptr<Account> account = database.get_account(CLIENT_ID);
+    Run_Result result;
+    result.bought = bought;
+    result.sold = sold;
+    result.memory_balance = account->get_balance();
+    result.memory_shares = account->get_quantity(ACTION_ID);
+    result.database_balance = database.execute_SQL_query_ID(fmt::format("SELECT balance FROM clients WHERE client_id = {}", CLIENT_ID));
+    result.database_shares = static_cast<int>(database.execute_SQL_query_double(fmt::format("SELECT quantity FROM client_portfolio WHERE client_id = {} AND action_id = {}", CLIENT_ID, ACTION_ID)));
+    result.lowest_balance = lowest_balance;
+    database.close_database();
+    return result;
+}
+
+// print a run and check the invariants, true if they hold
+bool report(const std::string& name, const Run_Result& result)
+{
+    // every successful buy costs PRICE per share, every successful sell brings PRICE per share
+    Money expected_balance = INITIAL_BALANCE - (result.bought - result.sold) * PRICE;
+    int expected_shares = INITIAL_SHARES + result.bought - result.sold;
+    bool no_overdraft = result.database_balance >= 0 && result.lowest_balance >= 0 && result.database_shares >= 0;
+    bool consistent = result.memory_balance == result.database_balance && result.memory_shares == result.database_shares; // exact, the amounts are integers
+    bool conserved = result.database_balance == expected_balance && result.database_shares == expected_shares;
+
+    fmt::print("{:<16} bought {:>5}  sold {:>5}\n", name, result.bought, result.sold);
+    fmt::print("{:<16} balance {:>10.2f} (memory {:>10.2f})  shares {:>5} (memory {:>5})  lowest balance {:>10.2f}\n",
+        "", money_to_double(result.database_balance), money_to_double(result.memory_balance), result.database_shares, result.memory_shares, money_to_double(result.lowest_balance));
+    fmt::print("{:<16} no overdraft: {}  memory = database: {}  cash and shares conserved: {}\n\n",
+        "", no_overdraft ? "OK" : "FAILED", consistent ? "OK" : "FAILED", conserved ? "OK" : "FAILED");
+    return no_overdraft && consistent && conserved;
+}
+
+
+// a client whose whole balance is reserved for one pending buy : the fills of that order spend its own reservation,
+// a buy of another order is refused, and the reservation is gone once the order is filled
+// batch = true : the fills go through a Settlement_Batch, false : through Account::settle
+bool run_reserved(const bool& batch)
+{
+    remove_database_files();
+    Database_Manager database(DATABASE_FILE, Database_Profile::BALANCED);
+    populate(database);
+    std::shared_ptr<Account> account = database.get_account(CLIENT_ID);
+    int quantity = static_cast<int>(INITIAL_BALANCE / PRICE);
+    account->open_order(RESERVED_ORDER_ID, Order_Type::BUY, ACTION_ID, quantity, INITIAL_BALANCE);
+
+    bool other_refused = !account->settle(Order_Type::BUY, ACTION_ID, 1, Price(PRICE));
+    bool filled = true;
+    for (int part : {quantity / 2, quantity - quantity / 2}){
+        if (batch){
+            Settlement_Batch settlement(database);
+            settlement.add_fill(CLIENT_ID, Order_Type::BUY, ACTION_ID, part, Price(PRICE), 0, 0, RESERVED_ORDER_ID);
+            filled = settlement.apply().empty() && filled;
+        }
+        else {
+            filled = account->settle(Order_Type::BUY, ACTION_ID, part, Price(PRICE), RESERVED_ORDER_ID) && filled;
+        }
+    }
+    Money database_balance = database.execute_SQL_query_ID(fmt::format("SELECT balance FROM clients WHERE client_id = {}", CLIENT_ID));
+    bool released = account->get_reserved() == 0 && account->get_open_order_count() == 0;
+    bool spent = account->get_balance() == 0 && database_balance == 0 && account->get_quantity(ACTION_ID) == INITIAL_SHARES + quantity;
+    database.close_database();
+
+    fmt::print("{:<16} other buy refused: {}  own fills accepted: {}  reservation released: {}  balance spent: {}\n",
+        batch ? "reserved, batch" : "reserved, settle", other_refused ? "OK" : "FAILED", filled ? "OK" : "FAILED", released ? "OK" : "FAILED", spent ? "OK" : "FAILED");
+    return other_refused && filled && released && spent;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int threads = (argc > 1) ? std::stoi(argv[1]) : DEFAULT_THREADS;
+    if (threads <= 0){
+        std::cerr << "Error: the number of threads must be positive.\n";
+        return 1;
+    }
+    fmt::print("Concurrent settlement of {} threads x {} orders against one client (balance {:.2f}, {} shares at {:.2f})\n\n",
+        threads, ORDERS_PER_THREAD, money_to_double(INITIAL_BALANCE), INITIAL_SHARES, money_to_double(PRICE));
+
+    report("check-then-act", run(threads, false)); // shown for comparison, expected to fail at high thread counts
+    bool atomic_ok = report("atomic", run(threads, true));
+    atomic_ok = run_reserved(false) && atomic_ok;
+    atomic_ok = run_reserved(true) && atomic_ok;
+
+    remove_database_files();
+    return atomic_ok ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+#include "matching_engine.hpp"
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+#define EXPIRY_MS 50 // lifetime of the orders that expire
+#define EXPIRY_WAIT_MS 2000 // longest wait for an expiry report, many timer ticks
+
+
+// print the result of a check and return it
+bool report(const std::string& name, const bool& ok)
+{
+    std::cout << std::left << std::setw(52) << name << (ok ? "OK" : "FAILED") << "\n";
+    return ok;
+}
+
+// resting LIMIT order of a client
+Order_Request limit_order(const uint64_t& order_id, const int& client_id, const Side& side, const int& quantity, const int64_t& tick)
+{
+    return {order_id, client_id, side, Order_Trigger::LIMIT, quantity, Price(tick), Price()};
+}
+
+// sell order ids of the fills, in execution order
+std::vector<uint64_t> get_sell_ids(const std::vector<Fill>& fills)
+{
+    std::vector<uint64_t> ids;
+    for (const Fill& fill : fills){
+        ids.push_back(fill.sell_order_id);
+    }
+    return ids;
+}
+
+
+// ---------------- Order Book ----------------
+// a decrease at the same price keeps the queue position, a new price or more shares send the order to the back of its level
+bool run_priority()
+{
+    std::vector<Fill> fills;
+
+    // two sells at 100 : the first one decreases and is still filled first
+    Order_Book decreased;
+    decreased.submit(limit_order(1, 1, Side::SELL, 10, 100), fills);
+    decreased.submit(limit_order(2, 2, Side::SELL, 10, 100), fills);
+    bool amended = decreased.amend(1, 5, Price(100), fills);
+    decreased.submit(limit_order(3, 3, Side::BUY, 5, 100), fills);
+    bool kept = amended && get_sell_ids(fills) == std::vector<uint64_t>{1} && decreased.find(1) == nullptr && decreased.find(2)->quantity == 10;
+
+    // the first one increases : the second one is filled first
+    fills.clear();
+    Order_Book increased;
+    increased.submit(limit_order(1, 1, Side::SELL, 10, 100), fills);
+    increased.submit(limit_order(2, 2, Side::SELL, 10, 100), fills);
+    amended = increased.amend(1, 15, Price(100), fills);
+    increased.submit(limit_order(3, 3, Side::BUY, 20, 100), fills);
+    bool lost_increase = amended && get_sell_ids(fills) == std::vector<uint64_t>{2, 1} && increased.find(1)->quantity == 5;
+
+    // the first one moves to the level of two later orders : it joins it behind them
+    fills.clear();
+    Order_Book moved;
+    moved.submit(limit_order(1, 1, Side::SELL, 10, 100), fills);
+    moved.submit(limit_order(2, 2, Side::SELL, 10, 101), fills);
+    moved.submit(limit_order(3, 3, Side::SELL, 10, 101), fills);
+    amended = moved.amend(1, 10, Price(101), fills);
+    moved.submit(limit_order(4, 4, Side::BUY, 25, 101), fills);
+    bool lost_price = amended && get_sell_ids(fills) == std::vector<uint64_t>{2, 3, 1} && moved.find(1)->quantity == 5;
+
+    bool ok = report("quantity decrease keeps the queue position", kept);
+    ok = report("quantity increase loses the queue position", lost_increase) && ok;
+    return report("price change loses the queue position", lost_price) && ok;
+}
+
+// the trades of a stop move the last price and trigger the next stops : lowest buy trigger first, oldest first within a trigger
+bool run_stop_cascade()
+{
+    std::vector<Fill> fills;
+    Order_Book book;
+    book.submit(limit_order(1, 1, Side::SELL, 5, 101), fills);
+    book.submit(limit_order(2, 2, Side::SELL, 10, 102), fills);
+    book.submit(limit_order(3, 3, Side::SELL, 10, 103), fills);
+    book.submit({10, 10, Side::BUY, Order_Trigger::STOP, 10, Price(), Price(102)}, fills);
+    book.submit({11, 11, Side::BUY, Order_Trigger::STOP, 10, Price(), Price(101)}, fills);
+    book.submit({12, 12, Side::BUY, Order_Trigger::STOP, 5, Price(), Price(101)}, fills);
+    bool waiting = fills.empty() && book.find(10) && book.find(11) && book.find(12);
+
+    // the trade at 101 triggers 11 (older) then 12, their trades at 102 and 103 trigger 10, whose last 5 shares find no seller
+    book.submit(limit_order(20, 20, Side::BUY, 5, 101), fills);
+    std::vector<uint64_t> triggered;
+    std::vector<uint64_t> dropped;
+    for (const Order_Event& event : book.get_events()){
+        (event.type == Event_Type::TRIGGERED ? triggered : dropped).push_back(event.order_id);
+    }
+    std::vector<uint64_t> buyers;
+    std::vector<int64_t> ticks;
+    for (const Fill& fill : fills){
+        buyers.push_back(fill.buy_order_id);
+        ticks.push_back(fill.price.get_ticks());
+    }
+
+    bool ok = report("stop orders wait below their trigger", waiting);
+    ok = report("stop cascade triggers in trigger then time order", triggered == std::vector<uint64_t>{11, 12, 10}) && ok;
+    ok = report("stop cascade fills in order", buyers == std::vector<uint64_t>{20, 11, 12, 10} && ticks == std::vector<int64_t>{101, 102, 103, 103}) && ok;
+    return report("unfilled triggered stop dropped", dropped == std::vector<uint64_t>{10} && book.find(10) == nullptr && book.get_last_price() == Price(103)) && ok;
+}
+
+// the crossed book accumulated before the open executes at the price of the highest volume, then the lowest imbalance
+bool run_auction()
+{
+    std::vector<Fill> fills;
+    Order_Book book;
+    bool reached = book.set_phase(Trading_Phase::PRE_CLOSE, fills) && book.set_phase(Trading_Phase::CLOSE, fills) && book.set_phase(Trading_Phase::PRE_OPEN, fills);
+    book.submit(limit_order(1, 1, Side::BUY, 10, 102), fills);
+    book.submit(limit_order(2, 2, Side::BUY, 10, 101), fills);
+    book.submit(limit_order(3, 3, Side::BUY, 10, 100), fills);
+    book.submit(limit_order(4, 4, Side::SELL, 5, 99), fills);
+    book.submit(limit_order(5, 5, Side::SELL, 10, 100), fills);
+    book.submit(limit_order(6, 6, Side::SELL, 10, 101), fills);
+    bool accumulated = reached && fills.empty() && book.get_bids().get_best_tick() > book.get_asks().get_best_tick();
+
+    // demand 30 30 20 10 and supply 5 15 25 25 from 99 to 102 : 20 shares execute at 101, 5 more shares are offered than bought
+    Auction auction = book.get_auction();
+    bool equilibrium = auction.price == Price(101) && auction.volume == 20 && auction.imbalance == -5;
+
+    bool opened = book.set_phase(Trading_Phase::OPEN, fills);
+    int64_t volume = 0;
+    bool one_price = true;
+    for (const Fill& fill : fills){
+        volume += fill.quantity;
+        one_price = one_price && fill.price == Price(101);
+    }
+    bool uncrossed = opened && volume == 20 && one_price && book.get_auction().volume == 0
+        && book.get_bids().get_best_tick() == 100 && book.get_asks().get_best_tick() == 101 && book.get_asks().get_quantity_at(101) == 5;
+
+    bool ok = report("auction orders rest without matching", accumulated);
+    ok = report("auction price, volume and imbalance", equilibrium) && ok;
+    return report("open executes the volume at one price, uncrossed", uncrossed) && ok;
+}
+
+
+// ---------------- Matching Engine ----------------
+// what a matching thread reported for a command
+struct Engine_Report
+{
+    Command_Type type;
+    uint64_t order_id;
+    int client_id;
+    bool accepted;
+    size_t fill_count;
+};
+
+// engine with one listed symbol, its reports are collected to be waited for
+class Engine_Probe
+{
+private:
+    std::mutex Mutex;
+    std::condition_variable Reported;
+    std::vector<Engine_Report> Reports;
+    Symbol_Registry Symbols;
+    Symbol_Id Symbol;
+    Matching_Engine Engine;
+
+public:
+    Engine_Probe() : Symbol(Symbols.add("ACME")), Engine([this](const Engine_Command& command, const Engine_Result& result){
+            std::lock_guard<std::mutex> lock(Mutex);
+            Reports.push_back({command.type, command.order_id, command.client_id, result.accepted, result.fills.size()});
+            Reported.notify_all();
+        }, Symbols, nullptr, 1)
+    {
+
+    }
+
+    // first report of a type and an order after the first reports, nullopt if none came within the wait
+    std::optional<Engine_Report> wait_for(const Command_Type& type, const uint64_t& order_id, const size_t& first, const int& wait_ms)
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        std::optional<Engine_Report> found;
+        Reported.wait_for(lock, std::chrono::milliseconds(wait_ms), [&](){
+            for (size_t i = first; i < Reports.size(); ++i){
+                if (Reports[i].type == type && Reports[i].order_id == order_id){
+                    found = Reports[i];
+                    return true;
+                }
+            }
+            return false;
+        });
+        return found;
+    }
+
+    size_t get_report_count()
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        return Reports.size();
+    }
+
+    // submit a command and wait for its own report
+    Engine_Report send(Engine_Command command)
+    {
+        command.symbol = Symbol;
+        size_t first = get_report_count();
+        Engine.submit(command);
+        return *wait_for(command.type, command.order_id, first, EXPIRY_WAIT_MS);
+    }
+
+    Engine_Report send_limit(const uint64_t& order_id, const int& client_id, const Side& side, const int& quantity, const int64_t& tick, const int64_t& expiration = 0)
+    {
+        return send({Command_Type::NEW, client_id, order_id, side, Order_Trigger::LIMIT, quantity, Price(tick), Price(), expiration, NO_SYMBOL});
+    }
+
+    Engine_Report send_cancel(const uint64_t& order_id, const int& client_id)
+    {
+        return send({Command_Type::CANCEL, client_id, order_id, Side::BUY, Order_Trigger::LIMIT, 0, Price(), Price(), 0, NO_SYMBOL});
+    }
+
+    Engine_Report send_amend(const uint64_t& order_id, const int& client_id, const int& quantity, const int64_t& tick)
+    {
+        return send({Command_Type::AMEND, client_id, order_id, Side::BUY, Order_Trigger::LIMIT, quantity, Price(tick), Price(), 0, NO_SYMBOL});
+    }
+};
+
+// only the client of an order may cancel or amend it
+bool run_ownership()
+{
+    Engine_Probe probe;
+    probe.send_limit(1, 1, Side::SELL, 10, 100);
+    bool refused = !probe.send_cancel(1, 2).accepted && !probe.send_amend(1, 2, 5, 100).accepted;
+    bool amended = probe.send_amend(1, 1, 5, 100).accepted;
+    bool cancelled = probe.send_cancel(1, 1).accepted && !probe.send_cancel(1, 1).accepted;
+
+    bool ok = report("cancel and amend of another client refused", refused);
+    ok = report("amend of the owner accepted", amended) && ok;
+    return report("cancel of the owner accepted once", cancelled) && ok;
+}
+
+// an order with an expiration leaves the book once it passed, and an order that left the book earlier drops its timer
+bool run_expiry()
+{
+    Engine_Probe probe;
+    size_t first = probe.get_report_count();
+    probe.send_limit(1, 1, Side::SELL, 10, 100, get_engine_time() + EXPIRY_MS);
+    std::optional<Engine_Report> expired = probe.wait_for(Command_Type::EXPIRE, 1, first, EXPIRY_WAIT_MS);
+    bool left = expired && expired->client_id == 1 && !probe.send_cancel(1, 1).accepted;
+
+    // order 2 is filled before its expiration, then its id comes back without one : a timer left behind would expire it
+    first = probe.get_report_count();
+    probe.send_limit(2, 1, Side::SELL, 10, 100, get_engine_time() + EXPIRY_MS);
+    bool filled = probe.send_limit(3, 2, Side::BUY, 10, 100).fill_count == 1;
+    probe.send_limit(2, 1, Side::SELL, 10, 100);
+    bool not_expired = !probe.wait_for(Command_Type::EXPIRE, 2, first, 4 * EXPIRY_MS) && probe.send_cancel(2, 1).accepted;
+
+    bool ok = report("expired order reported and out of the book", left);
+    return report("timer of a filled order dropped", filled && not_expired) && ok;
+}
+
+
+int main()
+{
+    bool ok = run_priority();
+    ok = run_stop_cascade() && ok;
+    ok = run_auction() && ok;
+    ok = run_ownership() && ok;
+    ok = run_expiry() && ok;
+    return ok ? 0 : 1;
+}
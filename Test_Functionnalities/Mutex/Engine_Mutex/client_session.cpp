@@ -0,0 +1,95 @@
+#include "client_session.hpp"
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+
+// constructor
+// start the writer
+Client_Session::Client_Session(const int& socket) : Socket(socket), Open(true)
+{
+    int no_delay = 1; // the writer already batches what is pending, a small batch must not wait for the ack of the previous one
+    setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    Writer = std::thread(&Client_Session::write_loop, this);
+}
+
+// destructor
+// stop the writer if it still runs
+Client_Session::~Client_Session()
+{
+    stop();
+}
+
+
+// take the pending bytes and send them, until closed
+// the lock is only held to swap the buffers : the pushes go on while send() waits for the client
+void Client_Session::write_loop()
+{
+    std::string batch;
+    while (true){
+        {
+            std::unique_lock<std::mutex> lock(Mutex);
+            Ready.wait(lock, [this]{ return !Pending.empty() || !Open; });
+            if (!Open){
+                return;
+            }
+            batch.swap(Pending);
+        }
+        size_t sent = 0;
+        while (sent < batch.size()){
+            ssize_t written = send(Socket, batch.data() + sent, batch.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0){
+                disconnect(); // the client is gone, its reader stops too
+                return;
+            }
+            sent += written;
+        }
+        batch.clear();
+    }
+}
+
+// stop accepting messages and wake the writer and the reader of the socket up
+// the socket is shut down under the lock : once stop() went through it, no other thread touches the socket, so its owner may close it
+void Client_Session::disconnect()
+{
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (!Open){
+            return;
+        }
+        Open = false;
+        Pending.clear();
+        shutdown(Socket, SHUT_RDWR); // a blocked send() or read() on the socket returns
+    }
+    Ready.notify_one();
+}
+
+
+// queue a message without waiting for the network, false if the session is closed (a push over SESSION_QUEUE_LIMIT closes it)
+bool Client_Session::push(const std::string& message)
+{
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (!Open){
+            return false;
+        }
+        if (Pending.size() + message.size() <= SESSION_QUEUE_LIMIT){
+            Pending += message;
+            Ready.notify_one();
+            return true;
+        }
+    }
+    std::cerr << "Error: client socket " << Socket << " does not read its messages, disconnected\n";
+    disconnect();
+    return false;
+}
+
+// the client left : drop what is pending and join the writer, the owner closes the socket afterwards
+void Client_Session::stop()
+{
+    disconnect();
+    if (Writer.joinable()){
+        Writer.join();
+    }
+}
@@ -0,0 +1,44 @@
+//==========================================================================
+// File that defines the outbound queue of a connected client
+//==========================================================================
+#ifndef CLIENT_SESSION_HPP
+#define CLIENT_SESSION_HPP
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+#define SESSION_QUEUE_LIMIT (1 << 20) // bytes waiting for a client before it is disconnected as too slow
+
+
+// the matching threads and the client thread push the messages of a client without touching its socket,
+// a writer thread sends them by batches, so a client that reads slowly only delays its own messages, never the matching
+// the messages of a session are sent in the order they were pushed
+class Client_Session
+{
+private:
+    int Socket;
+    std::mutex Mutex; // protects Pending and Open, and serializes the shutdown of the socket with stop()
+    std::condition_variable Ready;
+    std::string Pending; // bytes waiting for the writer
+    bool Open; // false once stopped or too slow : the pushes are dropped
+    std::thread Writer;
+
+    void write_loop(); // take the pending bytes and send them, until closed
+    void disconnect(); // stop accepting messages and wake the writer and the reader of the socket up
+
+public:
+    // constructor
+    Client_Session(const int& socket); // start the writer
+    // destructor
+    ~Client_Session(); // stop the writer if it still runs
+    Client_Session(const Client_Session&) = delete;
+    Client_Session& operator=(const Client_Session&) = delete;
+
+    bool push(const std::string& message); // queue a message without waiting for the network, false if the session is closed (a push over SESSION_QUEUE_LIMIT closes it)
+    void stop(); // the client left : drop what is pending and join the writer, the owner closes the socket afterwards
+};
+
+
+#endif // CLIENT_SESSION_HPP
@@ -0,0 +1,262 @@
+#include "matching_engine.hpp"
+#include <iostream>
+#include <stdexcept>
+
+
+static const std::vector<Order_Event> NO_EVENTS; // result of the commands that trigger nothing
+
+
+// Shard
+// constructor
+// simple init
+Matching_Engine::Shard::Shard(const size_t& ring_capacity) : Commands(ring_capacity), Expiries(get_engine_time() / ENGINE_TIMER_TICK_MS), Sleeping(0), Expiry_Count(0), Expire_Pending(false)
+{
+
+}
+
+
+// Matching_Engine
+// constructor
+// start the matching threads and the clock
+Matching_Engine::Matching_Engine(Report_Handler handler, const Symbol_Registry& symbols, Order_Store* store, const size_t& shard_count, const size_t& ring_capacity) : Handler(std::move(handler)), Store(store), Symbols(symbols), Books(symbols.get_capacity()), Spin_Count((std::thread::hardware_concurrency() > 1) ? ENGINE_SPIN_COUNT : 0), Running(true)
+{
+    for (size_t i = 0; i < std::max<size_t>(shard_count, 1); ++i){
+        Shards.push_back(std::make_unique<Shard>(ring_capacity));
+    }
+    // the shards are all created before a thread starts, the vector never moves afterwards
+    for (auto& shard : Shards){
+        shard->Thread = std::thread(&Matching_Engine::run, this, std::ref(*shard));
+    }
+    Clock = std::thread(&Matching_Engine::run_clock, this);
+}
+
+// destructor
+// stop the clock, process what is queued, then stop the threads
+Matching_Engine::~Matching_Engine()
+{
+    Running.store(false, std::memory_order_seq_cst);
+    Clock.join();
+    for (auto& shard : Shards){
+        shard->Sleeping.store(0, std::memory_order_seq_cst);
+        shard->Sleeping.notify_one();
+        shard->Thread.join();
+    }
+}
+
+
+// shard owning a symbol
+// the ids are dense, so consecutive listings go to consecutive shards
+Matching_Engine::Shard& Matching_Engine::get_shard(const Symbol_Id& symbol)
+{
+    return *Shards[symbol % Shards.size()];
+}
+
+// book of a symbol, created at its first command (matching thread only)
+Order_Book& Matching_Engine::get_book(const Symbol_Id& symbol)
+{
+    std::unique_ptr<Order_Book>& book = Books[symbol];
+    if (!book){
+        book = std::make_unique<Order_Book>(Symbols.get_tick_size(symbol));
+    }
+    return *book;
+}
+
+// loop of a matching thread : pop, process, report, sleep when idle
+void Matching_Engine::run(Shard& shard)
+{
+    Engine_Command command;
+    int idle_polls = 0;
+    while (true){
+        if (shard.Commands.try_pop(command)){
+            process(shard, command);
+            idle_polls = 0;
+            continue;
+        }
+        if (!Running.load(std::memory_order_acquire)){
+            return; // stopped and drained
+        }
+        if (++idle_polls < Spin_Count){
+            std::this_thread::yield();
+            continue;
+        }
+
+        // no command for a while : sleep until a producer wakes the thread up
+        // the flag is set before the ring is checked again, and a producer checks the flag after publishing, so a command is never missed
+        shard.Sleeping.store(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (shard.Commands.empty() && Running.load(std::memory_order_acquire)){
+            shard.Sleeping.wait(1, std::memory_order_acquire);
+        }
+        shard.Sleeping.store(0, std::memory_order_relaxed);
+        idle_polls = 0;
+    }
+}
+
+// loop of the clock : every tick, an EXPIRE command to the shards with due timers
+// a shard gets one EXPIRE at a time, so a slow matching thread never piles them up in its ring
+void Matching_Engine::run_clock()
+{
+    while (Running.load(std::memory_order_acquire)){
+        std::this_thread::sleep_for(std::chrono::milliseconds(ENGINE_TIMER_TICK_MS));
+        for (auto& shard : Shards){
+            if (shard->Expiry_Count.load(std::memory_order_relaxed) > 0 && !shard->Expire_Pending.exchange(true, std::memory_order_acq_rel)){
+                Engine_Command command{Command_Type::EXPIRE, 0, 0, Side::BUY, Order_Trigger::LIMIT, 0, Price(), Price(), 0, NO_SYMBOL};
+                push(*shard, command);
+            }
+        }
+    }
+}
+
+// apply a command to its book (matching thread only)
+void Matching_Engine::process(Shard& shard, const Engine_Command& command)
+{
+    if (command.type == Command_Type::EXPIRE){
+        expire(shard);
+        return;
+    }
+    shard.Fills.clear();
+    Order_Book& book = get_book(command.symbol);
+    bool accepted = false;
+    std::string view;
+    Side side = command.side;
+
+    switch (command.type){
+        case Command_Type::NEW:
+            accepted = book.submit({command.order_id, command.client_id, side, command.trigger, command.quantity, command.price, command.trigger_price}, shard.Fills);
+            break;
+        case Command_Type::CANCEL: {
+            const Book_Order* order = book.find(command.order_id);
+            accepted = order != nullptr && order->client_id == command.client_id;
+            if (accepted){
+                side = order->side;
+                Price price(order->tick);
+                book.cancel(command.order_id);
+                store_order(book, command.symbol, command.order_id, command.client_id, side, price, true);
+                forget_expiry(shard, book, command.order_id);
+            }
+            break;
+        }
+        case Command_Type::AMEND: {
+            const Book_Order* order = book.find(command.order_id);
+            if (order != nullptr && order->client_id == command.client_id){
+                side = order->side;
+                accepted = book.amend(command.order_id, command.quantity, command.price, shard.Fills);
+            }
+            break;
+        }
+        case Command_Type::VIEW:
+            view = book.to_string();
+            accepted = true;
+            break;
+        case Command_Type::PHASE:
+            accepted = book.set_phase(command.phase, shard.Fills);
+            break;
+        case Command_Type::EXPIRE:
+            break;
+    }
+
+    // a new order still in the book gets its timer, rounded up to the next tick
+    if (accepted && command.type == Command_Type::NEW && command.expiration > 0 && book.find(command.order_id) != nullptr){
+        shard.Expiries.schedule(command.order_id, (command.expiration + ENGINE_TIMER_TICK_MS - 1) / ENGINE_TIMER_TICK_MS, command.symbol);
+    }
+
+    // both orders of each fill (a triggered stop order may trade on either side), the order itself, then the quantities dropped
+    bool matched = accepted && (command.type == Command_Type::NEW || command.type == Command_Type::AMEND || command.type == Command_Type::PHASE);
+    if (matched){
+        for (const Fill& fill : shard.Fills){
+            store_order(book, command.symbol, fill.buy_order_id, fill.buyer, Side::BUY, fill.price);
+            store_order(book, command.symbol, fill.sell_order_id, fill.seller, Side::SELL, fill.price);
+            forget_expiry(shard, book, fill.buy_order_id);
+            forget_expiry(shard, book, fill.sell_order_id);
+        }
+        if (command.type != Command_Type::PHASE){
+            store_order(book, command.symbol, command.order_id, command.client_id, side, command.price);
+            forget_expiry(shard, book, command.order_id);
+        }
+        for (const Order_Event& event : book.get_events()){
+            if (event.type == Event_Type::DROPPED){
+                store_order(book, command.symbol, event.order_id, event.client_id, event.side, Price(), true);
+                forget_expiry(shard, book, event.order_id);
+            }
+        }
+    }
+    shard.Expiry_Count.store(shard.Expiries.size(), std::memory_order_relaxed);
+    const std::vector<Order_Event>& events = matched ? book.get_events() : NO_EVENTS;
+    Handler(command, Engine_Result{accepted, shard.Fills, events, std::move(view)});
+}
+
+// remove the orders whose expiration passed, report and store them (matching thread only)
+// each expired order is reported as an EXPIRE command of its client, with the quantity and the price it had in the book
+void Matching_Engine::expire(Shard& shard)
+{
+    shard.Expire_Pending.store(false, std::memory_order_release); // the clock may send the next one
+    shard.Fills.clear();
+    shard.Expiries.advance(get_engine_time() / ENGINE_TIMER_TICK_MS, [&](const uint64_t& order_id, const Symbol_Id& symbol){
+        Order_Book& book = *Books[symbol];
+        const Book_Order* order = book.find(order_id);
+        if (order == nullptr){
+            return;
+        }
+        Engine_Command report{Command_Type::EXPIRE, order->client_id, order_id, order->side, order->trigger, order->quantity, Price(order->tick), Price(), 0, symbol};
+        book.cancel(order_id);
+        if (Store != nullptr){
+            Store->push({order_id, report.client_id, Symbols.get_symbol(symbol), report.side == Side::BUY, 0, report.price.get_ticks() * book.get_tick_size(), Order_Status::EXPIRED});
+        }
+        Handler(report, Engine_Result{true, shard.Fills, NO_EVENTS, ""});
+    });
+    shard.Expiry_Count.store(shard.Expiries.size(), std::memory_order_relaxed);
+}
+
+// drop the timer of an order that left the book
+void Matching_Engine::forget_expiry(Shard& shard, const Order_Book& book, const uint64_t& order_id)
+{
+    if (shard.Expiries.size() > 0 && book.find(order_id) == nullptr){
+        shard.Expiries.cancel(order_id);
+    }
+}
+
+// queue the new state of an order
+void Matching_Engine::store_order(const Order_Book& book, const Symbol_Id& symbol, const uint64_t& order_id, const int& client_id, const Side& side, const Price& price, const bool& cancelled)
+{
+    if (Store == nullptr){
+        return;
+    }
+    const Book_Order* resting = cancelled ? nullptr : book.find(order_id);
+    Order_Status status = cancelled ? Order_Status::CANCELLED : (resting ? Order_Status::PENDING : Order_Status::COMPLETED);
+    Store->push({order_id, client_id, Symbols.get_symbol(symbol), side == Side::BUY, resting ? resting->quantity : 0, (resting ? resting->tick : price.get_ticks()) * book.get_tick_size(), status});
+}
+
+
+size_t Matching_Engine::get_shard_count() const
+{
+    return Shards.size();
+}
+
+// hand a command to the thread of its symbol (which must be listed), waits only while that ring is full
+void Matching_Engine::submit(Engine_Command command)
+{
+    if (!Symbols.is_listed(command.symbol)){
+        std::cerr << "Error: the symbol " << command.symbol << " is not listed\n";
+        throw std::runtime_error("Unlisted symbol");
+    }
+    push(get_shard(command.symbol), command);
+}
+
+// hand a command to the ring of a shard and wake its thread up
+void Matching_Engine::push(Shard& shard, Engine_Command& command)
+{
+    while (!shard.Commands.try_push(command)){
+        std::this_thread::yield(); // the matching thread is behind : back-pressure on the order-entry thread
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (shard.Sleeping.load(std::memory_order_relaxed) == 1 && shard.Sleeping.exchange(0, std::memory_order_acq_rel) == 1){
+        shard.Sleeping.notify_one();
+    }
+}
+
+
+// ms since epoch, the clock of the expirations
+int64_t get_engine_time()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
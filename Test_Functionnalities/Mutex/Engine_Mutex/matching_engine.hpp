@@ -0,0 +1,122 @@
+//==========================================================================
+// File that defines the matching threads of the engine
+//==========================================================================
+#ifndef MATCHING_ENGINE_HPP
+#define MATCHING_ENGINE_HPP
+#include <chrono>
+#include <functional>
+#include <thread>
+#include "mpsc_ring.hpp"
+#include "order_book.hpp"
+#include "order_store.hpp"
+#include "symbol_registry.hpp"
+#include "timer_wheel.hpp"
+
+
+#define ENGINE_SHARD_COUNT 4 // default number of matching threads
+#define ENGINE_RING_CAPACITY 4096 // default number of commands waiting for one matching thread
+#define ENGINE_TIMER_TICK_MS 10 // resolution of the order expiries
+#define ENGINE_SPIN_COUNT 1000 // empty polls of a matching thread before it sleeps (none on a single core, where spinning only delays the producers)
+
+
+enum class Command_Type : uint8_t
+{
+    NEW,    // MARKET, LIMIT, STOP or LIMIT_STOP order
+    CANCEL, // remove a resting order of the client
+    AMEND,  // new quantity left and price of a resting order of the client
+    VIEW,   // copy of the book
+    PHASE,  // move the book to its next trading phase, uncrossing it when entering OPEN or CLOSE
+    EXPIRE  // fire the expiries of the shard that are due (sent by the engine clock), each expired order is reported as an EXPIRE of its own
+};
+
+
+// request of a client to the matching thread of a symbol
+struct Engine_Command
+{
+    Command_Type type;
+    int client_id;
+    uint64_t order_id; // given by the server for a NEW order
+    Side side;
+    Order_Trigger trigger; // NEW only
+    int quantity;
+    Price price; // LIMIT and LIMIT_STOP, in ticks of the symbol
+    Price trigger_price; // STOP and LIMIT_STOP
+    int64_t expiration; // NEW only : ms since epoch after which the order leaves the book, 0 : good till cancelled
+    Symbol_Id symbol; // listed in the registry of the engine, NO_SYMBOL for the EXPIRE of the clock
+    Trading_Phase phase = Trading_Phase::CONTINUOUS; // PHASE only
+};
+
+
+// outcome of a command, given to the report handler on the matching thread
+struct Engine_Result
+{
+    bool accepted; // false : invalid order, unknown order, order of another client or phase out of sequence
+    const std::vector<Fill>& fills; // executions of the command (or of the uncross) and of the stop orders it triggered, to settle
+    const std::vector<Order_Event>& events; // stop orders triggered and market quantities dropped
+    std::string view; // string representation of the book, for a VIEW
+};
+
+
+using Report_Handler = std::function<void(const Engine_Command& command, const Engine_Result& result)>;
+
+
+// sequencer : each symbol belongs to one shard (its id modulo the shard count), and each shard to one matching thread that alone owns its books
+// the books sit in one array indexed by symbol id, sized for the capacity of the registry : a command reaches its book without hashing a string,
+// and the array never grows, so the matching threads only ever touch their own slots
+// the order-entry threads hand their commands over through the bounded lock-free ring of the shard,
+// so the books are never locked, the commands of a symbol are processed one at a time in the order of the ring
+// the orders with an expiration sit in the timer wheel of their shard, a clock thread sends EXPIRE commands through the same rings,
+// so the expiries are sequenced with the orders and the wheel has a single owner too
+class Matching_Engine
+{
+private:
+    // one matching thread, its ring and the timers of its books
+    struct Shard
+    {
+        Mpsc_Ring<Engine_Command> Commands;
+        std::vector<Fill> Fills; // reused for every command
+        Timer_Wheel<Symbol_Id> Expiries; // order_id -> symbol of the orders with an expiration, in ticks of ENGINE_TIMER_TICK_MS
+        alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> Sleeping; // 1 while the matching thread waits for a command
+        std::atomic<size_t> Expiry_Count; // timers of the shard, read by the clock
+        std::atomic<bool> Expire_Pending; // an EXPIRE command is in the ring
+        std::thread Thread;
+
+        Shard(const size_t& ring_capacity); // simple init
+    };
+
+    std::vector<std::unique_ptr<Shard>> Shards;
+    Report_Handler Handler; // called by the matching threads after each command
+    Order_Store* Store; // new states of the orders, nullptr to keep them in memory only
+    const Symbol_Registry& Symbols; // ids, tickers and tick sizes of the listed symbols
+    std::vector<std::unique_ptr<Order_Book>> Books; // symbol id -> book, created and touched by the matching thread of the symbol only
+    int Spin_Count; // empty polls before sleeping
+    std::atomic<bool> Running;
+    std::thread Clock; // sends the EXPIRE commands
+
+    Shard& get_shard(const Symbol_Id& symbol); // shard owning a symbol
+    Order_Book& get_book(const Symbol_Id& symbol); // book of a symbol, created at its first command (matching thread only)
+    void run(Shard& shard); // loop of a matching thread : pop, process, report, sleep when idle
+    void run_clock(); // loop of the clock : every tick, an EXPIRE command to the shards with due timers
+    void push(Shard& shard, Engine_Command& command); // hand a command to the ring of a shard and wake its thread up
+    void process(Shard& shard, const Engine_Command& command); // apply a command to its book (matching thread only)
+    void expire(Shard& shard); // remove the orders whose expiration passed, report and store them (matching thread only)
+    void forget_expiry(Shard& shard, const Order_Book& book, const uint64_t& order_id); // drop the timer of an order that left the book
+    void store_order(const Order_Book& book, const Symbol_Id& symbol, const uint64_t& order_id, const int& client_id, const Side& side, const Price& price, const bool& cancelled = false); // queue the new state of an order
+
+public:
+    // constructor
+    Matching_Engine(Report_Handler handler, const Symbol_Registry& symbols, Order_Store* store = nullptr, const size_t& shard_count = ENGINE_SHARD_COUNT, const size_t& ring_capacity = ENGINE_RING_CAPACITY); // start the matching threads and the clock
+    // destructor
+    ~Matching_Engine(); // stop the clock, process what is queued, then stop the threads
+    Matching_Engine(const Matching_Engine&) = delete;
+    Matching_Engine& operator=(const Matching_Engine&) = delete;
+
+    size_t get_shard_count() const;
+    void submit(Engine_Command command); // hand a command to the thread of its symbol (which must be listed), waits only while that ring is full
+};
+
+
+int64_t get_engine_time(); // ms since epoch, the clock of the expirations
+
+
+#endif // MATCHING_ENGINE_HPP
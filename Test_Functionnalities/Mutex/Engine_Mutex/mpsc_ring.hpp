@@ -0,0 +1,95 @@
+//==========================================================================
+// File that defines the bounded lock-free queue feeding a matching thread
+//==========================================================================
+#ifndef MPSC_RING_HPP
+#define MPSC_RING_HPP
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+
+// bounded multi-producer single-consumer ring
+// each slot carries a sequence number : a producer claims a position with a CAS on Write_Position, writes the value
+// and publishes it by storing position + 1 in the slot, the consumer reads the slot once its sequence says it is published
+// and frees it for the next lap by storing position + capacity, no producer ever waits for another one
+template <typename T>
+class Mpsc_Ring
+{
+private:
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        std::atomic<size_t> Sequence; // position + 1 : published, position + capacity : free for the next lap
+        T Value;
+    };
+
+    size_t Capacity; // power of two
+    size_t Mask;
+    std::unique_ptr<Slot[]> Slots;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> Write_Position; // next position claimed by a producer
+    alignas(CACHE_LINE_SIZE) size_t Read_Position; // next position read by the consumer, only the consumer touches it
+
+public:
+    // constructor
+    // capacity is rounded up to a power of two
+    explicit Mpsc_Ring(const size_t& capacity) : Capacity(std::bit_ceil(std::max<size_t>(capacity, 2))), Mask(Capacity - 1), Slots(new Slot[Capacity]), Write_Position(0), Read_Position(0)
+    {
+        for (size_t i = 0; i < Capacity; ++i){
+            Slots[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    Mpsc_Ring(const Mpsc_Ring&) = delete;
+    Mpsc_Ring& operator=(const Mpsc_Ring&) = delete;
+
+    // move a value into the ring, false if the ring is full (the value is not moved)
+    bool try_push(T& value)
+    {
+        size_t position = Write_Position.load(std::memory_order_relaxed);
+        while (true){
+            Slot& slot = Slots[position & Mask];
+            size_t sequence = slot.Sequence.load(std::memory_order_acquire);
+            if (sequence == position){
+                // the slot is free for this lap : claim the position
+                if (Write_Position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                    slot.Value = std::move(value);
+                    slot.Sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < position){
+                return false; // the consumer has not freed the slot of the previous lap
+            }
+            else {
+                position = Write_Position.load(std::memory_order_relaxed); // another producer claimed it
+            }
+        }
+    }
+
+    // take the oldest value, false if the ring is empty (consumer thread only)
+    bool try_pop(T& value)
+    {
+        Slot& slot = Slots[Read_Position & Mask];
+        if (slot.Sequence.load(std::memory_order_acquire) != Read_Position + 1){
+            return false;
+        }
+        value = std::move(slot.Value);
+        slot.Sequence.store(Read_Position + Capacity, std::memory_order_release);
+        ++Read_Position;
+        return true;
+    }
+
+    // no value published, as seen by the consumer
+    bool empty() const
+    {
+        return Slots[Read_Position & Mask].Sequence.load(std::memory_order_acquire) != Read_Position + 1;
+    }
+};
+
+
+#endif // MPSC_RING_HPP
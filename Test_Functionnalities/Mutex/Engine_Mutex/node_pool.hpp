@@ -0,0 +1,250 @@
+//==========================================================================
+// File that defines the allocation-free storage of the book orders
+//==========================================================================
+#ifndef NODE_POOL_HPP
+#define NODE_POOL_HPP
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <sys/mman.h>
+
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+#define POOL_SLAB_BYTES (64 * 1024) // memory asked for at once when the free list is empty
+#define POOL_HUGE_PAGE_BYTES (2 * 1024 * 1024) // slab size when built with -DPOOL_HUGE_PAGES
+#define INDEX_INITIAL_CAPACITY 1024 // slots of an empty id index
+// #define POOL_HUGE_PAGES // back the slabs with 2 MiB pages : fewer TLB misses on deep books, falls back to normal pages if none is reserved
+
+
+// slab allocator of fixed-size nodes : each node takes a whole number of cache lines, so two orders never share a line,
+// and a released node goes on an intrusive free list (its first bytes hold the link) that the next acquire pops
+// once the pool has grown to the peak number of live nodes, acquiring and releasing never call malloc, the slabs are only freed with the pool
+template <typename T>
+class Node_Pool
+{
+private:
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>, "the nodes are plain data");
+    static_assert(sizeof(T) >= sizeof(void*), "a free node holds the link of the free list");
+
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        unsigned char Bytes[sizeof(T)];
+    };
+
+#ifdef POOL_HUGE_PAGES
+    static constexpr size_t SLAB_BYTES = POOL_HUGE_PAGE_BYTES;
+#else
+    static constexpr size_t SLAB_BYTES = POOL_SLAB_BYTES;
+#endif
+    static constexpr size_t SLAB_NODES = SLAB_BYTES / sizeof(Slot);
+
+    std::vector<Slot*> Slabs;
+    Slot* Free; // last released node, nullptr when the free list is empty
+    size_t Carved; // nodes handed out of the last slab, never released ones
+    size_t Used; // live nodes
+
+    // map a new slab, huge pages first when asked for
+    Slot* allocate_slab()
+    {
+#ifdef POOL_HUGE_PAGES
+        void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        memory = mmap(nullptr, SLAB_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (memory == MAP_FAILED){
+            // no reserved huge page : normal pages, that the kernel may still merge
+            memory = mmap(nullptr, SLAB_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED){
+                throw std::bad_alloc();
+            }
+#ifdef MADV_HUGEPAGE
+            madvise(memory, SLAB_BYTES, MADV_HUGEPAGE);
+#endif
+        }
+        return static_cast<Slot*>(memory);
+#else
+        return static_cast<Slot*>(::operator new(SLAB_BYTES, std::align_val_t(CACHE_LINE_SIZE)));
+#endif
+    }
+
+    void free_slab(Slot* slab)
+    {
+#ifdef POOL_HUGE_PAGES
+        munmap(slab, SLAB_BYTES);
+#else
+        ::operator delete(slab, std::align_val_t(CACHE_LINE_SIZE));
+#endif
+    }
+
+public:
+    // constructor
+    // simple init, no memory until the first node
+    Node_Pool() : Free(nullptr), Carved(SLAB_NODES), Used(0)
+    {
+
+    }
+    // destructor
+    // free the slabs, with the nodes still in use
+    ~Node_Pool()
+    {
+        for (Slot* slab : Slabs){
+            free_slab(slab);
+        }
+    }
+    Node_Pool(const Node_Pool&) = delete;
+    Node_Pool& operator=(const Node_Pool&) = delete;
+
+    // getters
+    size_t size() const // live nodes
+    {
+        return Used;
+    }
+
+    size_t get_capacity() const // nodes the slabs hold
+    {
+        return Slabs.size() * SLAB_NODES;
+    }
+
+    // a node holding a copy of the value, from the free list, or from the last slab, or from a new slab
+    T* acquire(const T& value)
+    {
+        Slot* slot = Free;
+        if (slot != nullptr){
+            std::memcpy(&Free, slot->Bytes, sizeof(Slot*));
+        }
+        else {
+            if (Carved == SLAB_NODES){
+                Slabs.push_back(allocate_slab());
+                Carved = 0;
+            }
+            slot = Slabs.back() + Carved++;
+        }
+        ++Used;
+        return new (slot->Bytes) T(value);
+    }
+
+    // give a node back, it is reused by the next acquire
+    void release(T* node)
+    {
+        Slot* slot = reinterpret_cast<Slot*>(node);
+        std::memcpy(slot->Bytes, &Free, sizeof(Slot*));
+        Free = slot;
+        --Used;
+    }
+};
+
+
+// open-addressing index from an id to a node : one flat array of slots probed linearly, so a lookup touches one or two cache lines
+// and inserting or erasing never allocates, the array only doubles when it would be more than half full (and is kept afterwards)
+// an erase shifts the following slots of the run back instead of leaving a tombstone, so the probe runs stay short under churn
+template <typename T>
+class Id_Index
+{
+private:
+    struct Entry
+    {
+        uint64_t id;
+        T* node; // nullptr : free slot
+    };
+
+    std::vector<Entry> Entries; // power-of-two size
+    size_t Mask;
+    size_t Count;
+
+    size_t home(const uint64_t& id) const // first slot probed for an id
+    {
+        return static_cast<size_t>((id * 0x9E3779B97F4A7C15ull) >> 32) & Mask; // Fibonacci hashing : sequential ids spread over the array
+    }
+
+    void grow()
+    {
+        std::vector<Entry> entries(Entries.size() * 2, Entry{0, nullptr});
+        entries.swap(Entries);
+        Mask = Entries.size() - 1;
+        for (const Entry& entry : entries){
+            if (entry.node != nullptr){
+                size_t slot = home(entry.id);
+                while (Entries[slot].node != nullptr){
+                    slot = (slot + 1) & Mask;
+                }
+                Entries[slot] = entry;
+            }
+        }
+    }
+
+public:
+    // constructor
+    // simple init, capacity is rounded up to a power of two
+    explicit Id_Index(const size_t& capacity = INDEX_INITIAL_CAPACITY) : Entries(std::bit_ceil(std::max<size_t>(capacity, 2)), Entry{0, nullptr}), Mask(Entries.size() - 1), Count(0)
+    {
+
+    }
+
+    // getters
+    size_t size() const
+    {
+        return Count;
+    }
+
+    // node of an id, nullptr if it is not indexed
+    T* find(const uint64_t& id) const
+    {
+        for (size_t slot = home(id); Entries[slot].node != nullptr; slot = (slot + 1) & Mask){
+            if (Entries[slot].id == id){
+                return Entries[slot].node;
+            }
+        }
+        return nullptr;
+    }
+
+    // index a node, false if the id is already indexed
+    bool insert(const uint64_t& id, T* node)
+    {
+        if (2 * (Count + 1) > Entries.size()){
+            grow();
+        }
+        size_t slot = home(id);
+        for (; Entries[slot].node != nullptr; slot = (slot + 1) & Mask){
+            if (Entries[slot].id == id){
+                return false;
+            }
+        }
+        Entries[slot] = Entry{id, node};
+        ++Count;
+        return true;
+    }
+
+    // remove an id, false if it is not indexed
+    bool erase(const uint64_t& id)
+    {
+        size_t slot = home(id);
+        for (; Entries[slot].id != id || Entries[slot].node == nullptr; slot = (slot + 1) & Mask){
+            if (Entries[slot].node == nullptr){
+                return false;
+            }
+        }
+        // backward shift : move back each following entry of the run that may sit in the freed slot
+        size_t next = (slot + 1) & Mask;
+        while (Entries[next].node != nullptr){
+            size_t wanted = home(Entries[next].id);
+            if (((next - wanted) & Mask) >= ((next - slot) & Mask)){
+                Entries[slot] = Entries[next];
+                slot = next;
+            }
+            next = (next + 1) & Mask;
+        }
+        Entries[slot] = Entry{0, nullptr};
+        --Count;
+        return true;
+    }
+};
+
+
+#endif // NODE_POOL_HPP
@@ -0,0 +1,585 @@
+#include "order_book.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+
+// Book_Side
+// constructor
+// simple init
+Book_Side::Book_Side(const Side& side) : Side_Of_Book(side), First_Tick(0), Best(-1), Order_Count(0)
+{
+
+}
+
+
+// grow the array so that it covers the tick, false if the range would exceed BOOK_MAX_LEVELS
+bool Book_Side::cover(const int64_t& tick)
+{
+    if (Levels.empty()){
+        First_Tick = std::max<int64_t>(tick - BOOK_INITIAL_LEVELS / 2, 0);
+        Levels.resize(BOOK_INITIAL_LEVELS);
+    }
+    int64_t end_tick = First_Tick + static_cast<int64_t>(Levels.size());
+    if (tick >= First_Tick && tick < end_tick){
+        return true;
+    }
+    if (!fits(tick)){
+        return false;
+    }
+
+    // the range at least doubles, towards the side of the new tick, so that growing is amortized
+    int64_t size = static_cast<int64_t>(Levels.size());
+    int64_t new_first = First_Tick;
+    int64_t new_end = end_tick;
+    if (tick < First_Tick){
+        new_first = std::max<int64_t>(std::min(tick, First_Tick - size), 0);
+    }
+    else {
+        new_end = std::max(tick + 1, end_tick + size);
+    }
+    // the doubling never exceeds the maximum range, the tick itself fits
+    if (new_end - new_first > BOOK_MAX_LEVELS){
+        if (tick < First_Tick){
+            new_first = std::max<int64_t>(new_end - BOOK_MAX_LEVELS, 0);
+        }
+        else {
+            new_end = new_first + BOOK_MAX_LEVELS;
+        }
+    }
+
+    std::vector<Price_Level> levels(new_end - new_first);
+    int64_t shift = First_Tick - new_first;
+    std::move(Levels.begin(), Levels.end(), levels.begin() + shift);
+    Levels.swap(levels);
+    if (Best >= 0){
+        Best += shift;
+    }
+    First_Tick = new_first;
+    return true;
+}
+
+// the level index is a better price than the other one
+bool Book_Side::is_better(const int64_t& index, const int64_t& than) const
+{
+    return (Side_Of_Book == Side::BUY) ? index > than : index < than;
+}
+
+// move Best to the next non-empty level after the best one emptied
+void Book_Side::find_next_best()
+{
+    if (Order_Count == 0){
+        Best = -1;
+        return;
+    }
+    // the orders left are all behind the old best level
+    int64_t step = (Side_Of_Book == Side::BUY) ? -1 : 1;
+    while (Levels[Best].head == nullptr){
+        Best += step;
+    }
+}
+
+
+// getters
+bool Book_Side::empty() const
+{
+    return Order_Count == 0;
+}
+
+size_t Book_Side::get_order_count() const
+{
+    return Order_Count;
+}
+
+// tick of the best level (the side must not be empty)
+int64_t Book_Side::get_best_tick() const
+{
+    return First_Tick + Best;
+}
+
+// oldest order of the best level, nullptr if the side is empty
+Book_Order* Book_Side::get_best_order() const
+{
+    return (Best >= 0) ? Levels[Best].head : nullptr;
+}
+
+// quantity resting at a tick, 0 outside the array
+int64_t Book_Side::get_quantity_at(const int64_t& tick) const
+{
+    int64_t index = tick - First_Tick;
+    return (index >= 0 && index < static_cast<int64_t>(Levels.size())) ? Levels[index].quantity : 0;
+}
+
+// non-empty levels, best first
+std::vector<const Price_Level*> Book_Side::get_levels() const
+{
+    std::vector<const Price_Level*> levels;
+    if (Best < 0){
+        return levels;
+    }
+    int64_t step = (Side_Of_Book == Side::BUY) ? -1 : 1;
+    size_t count = 0;
+    for (int64_t index = Best; count < Order_Count; index += step){
+        if (Levels[index].head != nullptr){
+            levels.push_back(&Levels[index]);
+            for (const Book_Order* order = Levels[index].head; order != nullptr; order = order->next){
+                ++count;
+            }
+        }
+    }
+    return levels;
+}
+
+// an order at this tick can rest without exceeding BOOK_MAX_LEVELS
+bool Book_Side::fits(const int64_t& tick) const
+{
+    if (tick < 0){
+        return false;
+    }
+    if (Levels.empty()){
+        return true;
+    }
+    int64_t first = std::min(tick, First_Tick);
+    int64_t end = std::max(tick + 1, First_Tick + static_cast<int64_t>(Levels.size()));
+    return end - first <= BOOK_MAX_LEVELS;
+}
+
+
+// orders
+// append a resting order at the tail of its level, false if its price is out of range
+bool Book_Side::push_back(Book_Order* order)
+{
+    if (!cover(order->tick)){
+        return false;
+    }
+    int64_t index = order->tick - First_Tick;
+    Price_Level& level = Levels[index];
+    order->prev = level.tail;
+    order->next = nullptr;
+    if (level.tail != nullptr){
+        level.tail->next = order;
+    }
+    else {
+        level.head = order;
+    }
+    level.tail = order;
+    level.quantity += order->quantity;
+    ++Order_Count;
+    if (Best < 0 || is_better(index, Best)){
+        Best = index;
+    }
+    return true;
+}
+
+// unlink an order from its level in O(1) (the node is not freed)
+void Book_Side::remove(Book_Order* order)
+{
+    int64_t index = order->tick - First_Tick;
+    Price_Level& level = Levels[index];
+    if (order->prev != nullptr){
+        order->prev->next = order->next;
+    }
+    else {
+        level.head = order->next;
+    }
+    if (order->next != nullptr){
+        order->next->prev = order->prev;
+    }
+    else {
+        level.tail = order->prev;
+    }
+    order->prev = nullptr;
+    order->next = nullptr;
+    level.quantity -= order->quantity;
+    --Order_Count;
+    if (index == Best && level.head == nullptr){
+        find_next_best();
+    }
+}
+
+// a quantity of the order was filled or amended away, the order keeps its place
+void Book_Side::reduce(Book_Order* order, const int& quantity)
+{
+    order->quantity -= quantity;
+    Levels[order->tick - First_Tick].quantity -= quantity;
+}
+
+
+// Order_Book
+// constructor
+// simple init
+Order_Book::Order_Book(const Money& tick_size) : Tick_Size(tick_size), Bids(Side::BUY), Asks(Side::SELL), Buy_Stops(Side::SELL), Sell_Stops(Side::BUY), Last_Tick(0), Phase(Trading_Phase::CONTINUOUS)
+{
+
+}
+
+
+// the last price reached the trigger price of a waiting stop order
+bool Order_Book::is_triggered(const Book_Order* stop) const
+{
+    if (Last_Tick == 0){
+        return false;
+    }
+    return (stop->side == Side::BUY) ? Last_Tick >= stop->tick : Last_Tick <= stop->tick;
+}
+
+// match an order, then rest it (LIMIT) or drop what is left (MARKET)
+void Order_Book::execute(Book_Order* order, std::vector<Fill>& fills)
+{
+    Book_Side& own = (order->side == Side::BUY) ? Bids : Asks;
+    Book_Side& other = (order->side == Side::BUY) ? Asks : Bids;
+    bool market = order->trigger == Order_Trigger::MARKET;
+
+    // match against the best levels of the other side, oldest order first
+    while (order->quantity > 0 && !other.empty()){
+        int64_t best_tick = other.get_best_tick();
+        if (!market && ((order->side == Side::BUY) ? best_tick > order->tick : best_tick < order->tick)){
+            break;
+        }
+        Book_Order* resting = other.get_best_order();
+        int traded = std::min(order->quantity, resting->quantity);
+        Price trade_price(best_tick); // the resting order's price wins
+        if (order->side == Side::BUY){
+            fills.push_back({order->client_id, resting->client_id, traded, trade_price, order->order_id, resting->order_id});
+        }
+        else {
+            fills.push_back({resting->client_id, order->client_id, traded, trade_price, resting->order_id, order->order_id});
+        }
+        order->quantity -= traded;
+        Last_Tick = best_tick;
+        consume(other, resting, traded);
+    }
+
+    // what is left rests at the tail of its level, or leaves the book
+    if (order->quantity > 0 && !market && own.push_back(order)){
+        return;
+    }
+    if (order->quantity > 0){
+        Events.push_back({Event_Type::DROPPED, order->order_id, order->client_id, order->side, order->quantity});
+    }
+    Orders.erase(order->order_id);
+    Pool.release(order);
+}
+
+// execute the stop orders crossed by the last price, until the trades stop moving it
+void Order_Book::trigger_stops(std::vector<Fill>& fills)
+{
+    while (true){
+        Book_Order* stop = Buy_Stops.get_best_order();
+        if (stop == nullptr || !is_triggered(stop)){
+            stop = Sell_Stops.get_best_order();
+            if (stop == nullptr || !is_triggered(stop)){
+                return;
+            }
+        }
+        ((stop->side == Side::BUY) ? Buy_Stops : Sell_Stops).remove(stop);
+        Events.push_back({Event_Type::TRIGGERED, stop->order_id, stop->client_id, stop->side, stop->quantity});
+        // a STOP becomes a MARKET order, a LIMIT_STOP a LIMIT order at its own price
+        stop->trigger = (stop->trigger == Order_Trigger::STOP) ? Order_Trigger::MARKET : Order_Trigger::LIMIT;
+        stop->tick = stop->limit_tick;
+        execute(stop, fills); // may move the last price and trigger more stops
+    }
+}
+
+
+// fill a quantity of a resting order, freed once empty
+void Order_Book::consume(Book_Side& side, Book_Order* order, const int& quantity)
+{
+    if (quantity == order->quantity){
+        side.remove(order);
+        Orders.erase(order->order_id);
+        Pool.release(order);
+    }
+    else {
+        side.reduce(order, quantity);
+    }
+}
+
+// execute the crossing orders at the equilibrium price, best prices first
+// the buys at or above the price and the sells at or below it are filled head first, each trade at the equilibrium price,
+// a volume that maximizes the executions leaves the book uncrossed
+void Order_Book::uncross(std::vector<Fill>& fills)
+{
+    Auction auction = get_auction();
+    Price price = auction.price;
+    int64_t remaining = auction.volume;
+    while (remaining > 0){
+        Book_Order* bid = Bids.get_best_order();
+        Book_Order* ask = Asks.get_best_order();
+        int traded = static_cast<int>(std::min<int64_t>({bid->quantity, ask->quantity, remaining}));
+        fills.push_back({bid->client_id, ask->client_id, traded, price, bid->order_id, ask->order_id});
+        remaining -= traded;
+        consume(Bids, bid, traded);
+        consume(Asks, ask, traded);
+    }
+    if (auction.volume > 0){
+        Last_Tick = auction.price.get_ticks();
+    }
+}
+
+
+// getters
+Money Order_Book::get_tick_size() const
+{
+    return Tick_Size;
+}
+
+const Book_Side& Order_Book::get_bids() const
+{
+    return Bids;
+}
+
+const Book_Side& Order_Book::get_asks() const
+{
+    return Asks;
+}
+
+// resting or waiting order of an id, nullptr if it is not in the book
+const Book_Order* Order_Book::find(const uint64_t& order_id) const
+{
+    return Orders.find(order_id);
+}
+
+// price of the last trade, 0 before the first one
+Price Order_Book::get_last_price() const
+{
+    return Price(Last_Tick);
+}
+
+// stop orders triggered and market quantities dropped by the last submit, amend or phase change
+const std::vector<Order_Event>& Order_Book::get_events() const
+{
+    return Events;
+}
+
+Trading_Phase Order_Book::get_phase() const
+{
+    return Phase;
+}
+
+// PRE_OPEN or PRE_CLOSE : the orders rest without matching
+bool Order_Book::is_accumulating() const
+{
+    return Phase == Trading_Phase::PRE_OPEN || Phase == Trading_Phase::PRE_CLOSE;
+}
+
+// equilibrium of the crossed part of the book, one sweep over its ticks
+// only the ticks between the best ask and the best bid can execute : the demand at a tick is the bid quantity at or above it,
+// the supply the ask quantity at or below it, the volume is the lower of both, the highest volume wins,
+// then the lowest imbalance, then the price nearest the last trade (the middle of the crossed range before the first one)
+Auction Order_Book::get_auction() const
+{
+    Auction best{Price(), 0, 0};
+    if (Bids.empty() || Asks.empty() || Bids.get_best_tick() < Asks.get_best_tick()){
+        return best;
+    }
+    int64_t low = Asks.get_best_tick();
+    int64_t high = Bids.get_best_tick();
+    size_t count = static_cast<size_t>(high - low + 1);
+    Demand.resize(count); // the capacity is kept from one auction to the next
+
+    // cumulative demand, from the highest tick down
+    int64_t demand = 0;
+    for (size_t i = count; i-- > 0;){
+        demand += Bids.get_quantity_at(low + static_cast<int64_t>(i));
+        Demand[i] = demand;
+    }
+
+    // cumulative supply, from the lowest tick up, and the best tick in the same pass
+    int64_t reference = (Last_Tick > 0) ? Last_Tick : (low + high) / 2;
+    int64_t supply = 0;
+    int64_t best_distance = 0;
+    for (size_t i = 0; i < count; ++i){
+        int64_t tick = low + static_cast<int64_t>(i);
+        supply += Asks.get_quantity_at(tick);
+        int64_t volume = std::min(Demand[i], supply);
+        int64_t imbalance = Demand[i] - supply;
+        int64_t distance = std::abs(tick - reference);
+        if (volume > best.volume
+            || (volume == best.volume && std::abs(imbalance) < std::abs(best.imbalance))
+            || (volume == best.volume && std::abs(imbalance) == std::abs(best.imbalance) && distance < best_distance)){
+            best = {Price(tick), volume, imbalance};
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+
+// orders
+// match an order and rest or drop what is left, or make a stop order wait, the fills are appended (with the ones of the stops it triggers), false if the request is invalid or the id is in the book (nothing is done)
+bool Order_Book::submit(const Order_Request& request, std::vector<Fill>& fills)
+{
+    Events.clear();
+    bool has_price = request.trigger == Order_Trigger::LIMIT || request.trigger == Order_Trigger::LIMIT_STOP;
+    bool is_stop = request.trigger == Order_Trigger::STOP || request.trigger == Order_Trigger::LIMIT_STOP;
+    int64_t tick = has_price ? request.price.get_ticks() : 0;
+    int64_t trigger_tick = is_stop ? request.trigger_price.get_ticks() : 0;
+    Book_Side& own = (request.side == Side::BUY) ? Bids : Asks;
+    Book_Side& stops = (request.side == Side::BUY) ? Buy_Stops : Sell_Stops;
+    bool closed = Phase == Trading_Phase::CLOSE || (is_accumulating() && request.trigger == Order_Trigger::MARKET); // a market order has no price to rest at
+    if (closed || request.quantity <= 0 || Orders.find(request.order_id) != nullptr
+        || (has_price && (tick <= 0 || !own.fits(tick)))
+        || (is_stop && (trigger_tick <= 0 || !stops.fits(trigger_tick)))){
+        return false;
+    }
+
+    Book_Order* order = Pool.acquire({request.order_id, request.client_id, request.quantity, tick, tick, request.side, request.trigger, nullptr, nullptr});
+    Orders.insert(request.order_id, order);
+
+    // a stop order waits for its trigger price, unless the last price already reached it (nothing triggers while accumulating)
+    if (is_stop){
+        order->tick = trigger_tick;
+        if (is_accumulating() || !is_triggered(order)){
+            stops.push_back(order);
+            return true;
+        }
+        Events.push_back({Event_Type::TRIGGERED, order->order_id, order->client_id, order->side, order->quantity});
+        order->trigger = (order->trigger == Order_Trigger::STOP) ? Order_Trigger::MARKET : Order_Trigger::LIMIT;
+        order->tick = order->limit_tick;
+    }
+    // accumulating : the order rests without matching, until the uncross
+    if (is_accumulating()){
+        own.push_back(order);
+        return true;
+    }
+    size_t first_fill = fills.size();
+    execute(order, fills);
+    if (fills.size() > first_fill){
+        trigger_stops(fills);
+    }
+    return true;
+}
+
+// unlink and free a resting or waiting order in O(1), false if it is not in the book
+bool Order_Book::cancel(const uint64_t& order_id)
+{
+    Book_Order* order = Orders.find(order_id);
+    if (order == nullptr){
+        return false;
+    }
+    if (order->trigger == Order_Trigger::STOP || order->trigger == Order_Trigger::LIMIT_STOP){
+        ((order->side == Side::BUY) ? Buy_Stops : Sell_Stops).remove(order);
+    }
+    else {
+        ((order->side == Side::BUY) ? Bids : Asks).remove(order);
+    }
+    Orders.erase(order_id);
+    Pool.release(order);
+    return true;
+}
+
+// new quantity left and price of a resting LIMIT order : a decrease at the same price keeps the queue position, otherwise the order loses it and is matched again, false if invalid (nothing is done)
+bool Order_Book::amend(const uint64_t& order_id, const int& quantity, const Price& price, std::vector<Fill>& fills)
+{
+    Events.clear();
+    Book_Order* order = Orders.find(order_id);
+    int64_t tick = price.get_ticks();
+    if (order == nullptr || order->trigger != Order_Trigger::LIMIT || quantity <= 0 || tick <= 0 || Phase == Trading_Phase::CLOSE){
+        return false;
+    }
+    Book_Side& own = (order->side == Side::BUY) ? Bids : Asks;
+    if (!own.fits(tick)){
+        return false;
+    }
+
+    // same price and no more shares : the order keeps its place in the queue
+    if (tick == order->tick && quantity <= order->quantity){
+        own.reduce(order, order->quantity - quantity);
+        return true;
+    }
+
+    // new price or more shares : the order goes to the back of its new level, after matching what it now crosses
+    Order_Request request{order_id, order->client_id, order->side, Order_Trigger::LIMIT, quantity, price, Price()};
+    own.remove(order);
+    Orders.erase(order_id);
+    Pool.release(order);
+    return submit(request, fills);
+}
+
+
+// move to the next phase of the day, uncrossing the book when entering OPEN or CLOSE (the fills are appended), false if the phase does not follow the current one
+// PRE_OPEN -> OPEN -> CONTINUOUS -> PRE_CLOSE -> CLOSE -> PRE_OPEN, the stops crossed by the opening price trigger as trading goes on
+bool Order_Book::set_phase(const Trading_Phase& phase, std::vector<Fill>& fills)
+{
+    Events.clear();
+    Trading_Phase next = (Phase == Trading_Phase::CLOSE) ? Trading_Phase::PRE_OPEN : static_cast<Trading_Phase>(static_cast<uint8_t>(Phase) + 1);
+    if (phase != next){
+        return false;
+    }
+    Phase = phase;
+    if (phase == Trading_Phase::OPEN || phase == Trading_Phase::CLOSE){
+        size_t first_fill = fills.size();
+        uncross(fills);
+        if (phase == Trading_Phase::OPEN && fills.size() > first_fill){
+            trigger_stops(fills);
+        }
+    }
+    return true;
+}
+
+
+// string representation
+// Buys: [qty@price] ... best first, then Sells: [qty@price] ..., then the waiting stops
+std::string Order_Book::to_string() const
+{
+    std::ostringstream oss;
+    // outside continuous trading : the phase, and the price the auction would uncross at
+    if (Phase != Trading_Phase::CONTINUOUS){
+        oss << "  Phase: " << trading_phase_to_string(Phase) << "\n";
+    }
+    if (is_accumulating()){
+        Auction auction = get_auction();
+        oss << "  Indicative: " << auction.volume << "@" << price_to_string(auction.price, Tick_Size) << "\n";
+    }
+    oss << "  Buys: ";
+    for (const Price_Level* level : Bids.get_levels()){
+        for (const Book_Order* order = level->head; order != nullptr; order = order->next){
+            oss << "[" << order->quantity << "@" << price_to_string(Price(order->tick), Tick_Size) << "] ";
+        }
+    }
+    oss << "\n  Sells: ";
+    for (const Price_Level* level : Asks.get_levels()){
+        for (const Book_Order* order = level->head; order != nullptr; order = order->next){
+            oss << "[" << order->quantity << "@" << price_to_string(Price(order->tick), Tick_Size) << "] ";
+        }
+    }
+    oss << "\n";
+    // stops : [qty@trigger] (with ->limit for a LIMIT_STOP), the next to trigger first
+    if (!Buy_Stops.empty() || !Sell_Stops.empty()){
+        for (const Book_Side* stops : {&Buy_Stops, &Sell_Stops}){
+            oss << ((stops == &Buy_Stops) ? "  Buy stops: " : "  Sell stops: ");
+            for (const Price_Level* level : stops->get_levels()){
+                for (const Book_Order* order = level->head; order != nullptr; order = order->next){
+                    oss << "[" << order->quantity << "@" << price_to_string(Price(order->tick), Tick_Size);
+                    if (order->trigger == Order_Trigger::LIMIT_STOP){
+                        oss << "->" << price_to_string(Price(order->limit_tick), Tick_Size);
+                    }
+                    oss << "] ";
+                }
+            }
+            oss << "\n";
+        }
+    }
+    return oss.str();
+}
+
+
+// converting a Trading_Phase enum to a string
+std::string trading_phase_to_string(const Trading_Phase& phase)
+{
+    switch (phase){
+        case Trading_Phase::PRE_OPEN:
+            return "PRE_OPEN";
+        case Trading_Phase::OPEN:
+            return "OPEN";
+        case Trading_Phase::CONTINUOUS:
+            return "CONTINUOUS";
+        case Trading_Phase::PRE_CLOSE:
+            return "PRE_CLOSE";
+        case Trading_Phase::CLOSE:
+            return "CLOSE";
+        default:
+            return "UNKNOWN";
+    }
+}
@@ -0,0 +1,219 @@
+//==========================================================================
+// File that defines the limit order book of one symbol
+//==========================================================================
+#ifndef ORDER_BOOK_HPP
+#define ORDER_BOOK_HPP
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "node_pool.hpp"
+#include "price.hpp"
+
+
+#define BOOK_INITIAL_LEVELS 1024 // price levels allocated around the first order of a side
+#define BOOK_MAX_LEVELS (1 << 22) // widest price range a side may cover, in ticks
+
+
+enum class Side : uint8_t
+{
+    BUY,
+    SELL
+};
+
+
+// as Order_Trigger of Src_App
+enum class Order_Trigger : uint8_t
+{
+    MARKET,     // fills at any price, what cannot be filled at once is dropped
+    LIMIT,      // fills at the price or better, what is left rests in the book
+    STOP,       // becomes a MARKET order once a trade reaches the trigger price
+    LIMIT_STOP  // becomes a LIMIT order once a trade reaches the trigger price
+};
+
+
+// order sent to the book
+struct Order_Request
+{
+    uint64_t order_id;
+    int client_id;
+    Side side;
+    Order_Trigger trigger;
+    int quantity;
+    Price price;         // LIMIT and LIMIT_STOP
+    Price trigger_price; // STOP and LIMIT_STOP
+};
+
+
+// resting order, node of the FIFO list of its price level (or of its trigger level while a stop order waits)
+// plain data taken from the node pool of the book, one cache line per order
+struct Book_Order
+{
+    uint64_t order_id;
+    int client_id;
+    int quantity; // quantity left
+    int64_t tick; // price in ticks, the trigger price while a stop order waits
+    int64_t limit_tick; // price of a LIMIT_STOP order once triggered
+    Side side;
+    Order_Trigger trigger; // STOP or LIMIT_STOP while waiting, MARKET or LIMIT once triggered
+    Book_Order* prev; // older order of the level
+    Book_Order* next; // newer order of the level
+};
+
+
+// orders resting at one price, oldest first
+struct Price_Level
+{
+    Book_Order* head = nullptr; // oldest order, filled first
+    Book_Order* tail = nullptr; // newest order
+    int64_t quantity = 0; // sum of the quantities of the level
+};
+
+
+// one execution between an incoming order and a resting one, at the resting order's price
+struct Fill
+{
+    int buyer;
+    int seller;
+    int quantity;
+    Price price;
+    uint64_t buy_order_id;
+    uint64_t sell_order_id;
+};
+
+
+// as the phase messages of Src_App : the auction phases collect the orders without matching them, entering OPEN or CLOSE uncrosses the book
+enum class Trading_Phase : uint8_t
+{
+    PRE_OPEN,   // accumulating for the opening auction
+    OPEN,       // opening auction uncrossed, the orders match as in CONTINUOUS
+    CONTINUOUS, // continuous matching
+    PRE_CLOSE,  // accumulating for the closing auction
+    CLOSE       // closing auction uncrossed, no new order until PRE_OPEN
+};
+
+
+// equilibrium of a call auction
+struct Auction
+{
+    Price price; // price that executes the most volume
+    int64_t volume; // 0 if the book does not cross
+    int64_t imbalance; // demand - supply left at that price
+};
+
+
+enum class Event_Type : uint8_t
+{
+    TRIGGERED, // a trade reached the trigger price of a stop order
+    DROPPED    // the quantity of a market order that found no counterpart left the book
+};
+
+
+// what happened to an order other than a fill, during a submit or an amend
+struct Order_Event
+{
+    Event_Type type;
+    uint64_t order_id;
+    int client_id;
+    Side side;
+    int quantity; // quantity triggered or dropped
+};
+
+
+// one side of the book : a flat array of price levels indexed by tick offset, and the index of the best level
+// the array covers [First_Tick, First_Tick + Levels.size()) and grows when an order falls outside, a price is its own index
+class Book_Side
+{
+private:
+    Side Side_Of_Book; // BUY : the best level is the highest, SELL : the lowest
+    std::vector<Price_Level> Levels; // Levels[i] holds the orders at tick First_Tick + i
+    int64_t First_Tick; // tick of Levels[0]
+    int64_t Best; // index of the best level, -1 when the side is empty
+    size_t Order_Count; // resting orders of the side
+
+    bool cover(const int64_t& tick); // grow the array so that it covers the tick, false if the range would exceed BOOK_MAX_LEVELS
+    bool is_better(const int64_t& index, const int64_t& than) const; // the level index is a better price than the other one
+    void find_next_best(); // move Best to the next non-empty level after the best one emptied
+
+public:
+    // constructor
+    Book_Side(const Side& side); // simple init
+
+    // getters
+    bool empty() const;
+    size_t get_order_count() const;
+    int64_t get_best_tick() const; // tick of the best level (the side must not be empty)
+    Book_Order* get_best_order() const; // oldest order of the best level, nullptr if the side is empty
+    int64_t get_quantity_at(const int64_t& tick) const; // quantity resting at a tick, 0 outside the array
+    std::vector<const Price_Level*> get_levels() const; // non-empty levels, best first
+    bool fits(const int64_t& tick) const; // an order at this tick can rest without exceeding BOOK_MAX_LEVELS
+
+    // orders
+    bool push_back(Book_Order* order); // append a resting order at the tail of its level, false if its price is out of range
+    void remove(Book_Order* order); // unlink an order from its level in O(1) (the node is not freed)
+    void reduce(Book_Order* order, const int& quantity); // a quantity of the order was filled or amended away, the order keeps its place
+};
+
+
+// limit order book of one symbol, with price-time priority
+// an incoming order is matched against the best levels of the other side, head first, then rests at the tail of its level
+// the resting orders are indexed by order id, so a cancel or an amend reaches its node without searching the levels
+// the orders live in a node pool and the index is an open-addressing array : once the book reached its peak depth,
+// adding, filling and cancelling orders allocate nothing
+// the waiting stop orders sit in two trigger indexes, sorted by trigger price like the book sides : after the trades of an order,
+// only the stops crossed by the last price are walked, oldest first within a trigger price
+// in the auction phases the limit orders rest without matching, the book may cross until the uncross executes it at one price
+class Order_Book
+{
+private:
+    Money Tick_Size; // price step of the symbol, only used to print the prices
+    Book_Side Bids;
+    Book_Side Asks;
+    Book_Side Buy_Stops; // trigger when the last price rises to them : lowest trigger first, ordered like the asks
+    Book_Side Sell_Stops; // trigger when the last price falls to them : highest trigger first, ordered like the bids
+    Node_Pool<Book_Order> Pool; // nodes of the resting and waiting orders, freed with the book
+    Id_Index<Book_Order> Orders; // order_id -> resting or waiting order
+    int64_t Last_Tick; // price of the last trade, 0 before the first one
+    std::vector<Order_Event> Events; // events of the last submit, amend or phase change
+    Trading_Phase Phase;
+    mutable std::vector<int64_t> Demand; // cumulative bid quantity of each crossed tick, scratch reused by every auction
+
+    bool is_triggered(const Book_Order* stop) const; // the last price reached the trigger price of a waiting stop order
+    void execute(Book_Order* order, std::vector<Fill>& fills); // match an order, then rest it (LIMIT) or drop what is left (MARKET)
+    void trigger_stops(std::vector<Fill>& fills); // execute the stop orders crossed by the last price, until the trades stop moving it
+    void consume(Book_Side& side, Book_Order* order, const int& quantity); // fill a quantity of a resting order, freed once empty
+    void uncross(std::vector<Fill>& fills); // execute the crossing orders at the equilibrium price, best prices first
+
+public:
+    // constructor
+    Order_Book(const Money& tick_size = DEFAULT_TICK_SIZE); // simple init
+    Order_Book(const Order_Book&) = delete;
+    Order_Book& operator=(const Order_Book&) = delete;
+
+    // getters
+    Money get_tick_size() const;
+    const Book_Side& get_bids() const;
+    const Book_Side& get_asks() const;
+    const Book_Order* find(const uint64_t& order_id) const; // resting or waiting order of an id, nullptr if it is not in the book
+    Price get_last_price() const; // price of the last trade, 0 before the first one
+    const std::vector<Order_Event>& get_events() const; // stop orders triggered and market quantities dropped by the last submit, amend or phase change
+    Trading_Phase get_phase() const;
+    bool is_accumulating() const; // PRE_OPEN or PRE_CLOSE : the orders rest without matching
+    Auction get_auction() const; // equilibrium of the crossed part of the book, one sweep over its ticks
+
+    // orders
+    bool submit(const Order_Request& request, std::vector<Fill>& fills); // match an order and rest or drop what is left, or make a stop order wait, the fills are appended (with the ones of the stops it triggers), false if the request is invalid or the id is in the book (nothing is done)
+    bool cancel(const uint64_t& order_id); // unlink and free a resting or waiting order in O(1), false if it is not in the book
+    bool amend(const uint64_t& order_id, const int& quantity, const Price& price, std::vector<Fill>& fills); // new quantity left and price of a resting LIMIT order : a decrease at the same price keeps the queue position, otherwise the order loses it and is matched again, false if invalid (nothing is done)
+    bool set_phase(const Trading_Phase& phase, std::vector<Fill>& fills); // move to the next phase of the day, uncrossing the book when entering OPEN or CLOSE (the fills are appended), false if the phase does not follow the current one
+
+    // string representation
+    std::string to_string() const; // Buys: [qty@price] ... best first, then Sells: [qty@price] ..., then the waiting stops
+};
+
+
+// converting a Trading_Phase enum to a string
+std::string trading_phase_to_string(const Trading_Phase& phase);
+
+
+#endif // ORDER_BOOK_HPP
@@ -0,0 +1,168 @@
+#include "order_store.hpp"
+#include <iostream>
+#include <stdexcept>
+
+
+// constructor
+// open the database, create the table and start the writer
+Order_Store::Order_Store(const std::string& filename) : Database(nullptr), Upsert(nullptr), Running(true)
+{
+    if (sqlite3_open(filename.c_str(), &Database) != SQLITE_OK){
+        std::cerr << "Error opening database: " << sqlite3_errmsg(Database) << "\n";
+        sqlite3_close(Database);
+        throw std::runtime_error("Failed to open the order store");
+    }
+    const char* create_table = R"(
+        PRAGMA journal_mode = WAL;
+        PRAGMA synchronous = NORMAL;
+        CREATE TABLE IF NOT EXISTS orders (
+            order_id INTEGER PRIMARY KEY,
+            client_id INTEGER NOT NULL,
+            symbol TEXT NOT NULL,
+            order_type TEXT NOT NULL,   -- BUY or SELL
+            quantity INTEGER NOT NULL,  -- quantity left in the book
+            price INTEGER NOT NULL,     -- in money units (1/10000 of the currency)
+            order_status TEXT NOT NULL  -- PENDING, COMPLETED, CANCELLED or EXPIRED
+        );
+    )";
+    const char* upsert = R"(
+        INSERT INTO orders (order_id, client_id, symbol, order_type, quantity, price, order_status) VALUES (?, ?, ?, ?, ?, ?, ?)
+        ON CONFLICT(order_id) DO UPDATE SET quantity = excluded.quantity, price = excluded.price, order_status = excluded.order_status
+    )";
+    char* error = nullptr;
+    if (!migrate_prices(error)
+        || sqlite3_exec(Database, create_table, nullptr, nullptr, &error) != SQLITE_OK
+        || sqlite3_prepare_v2(Database, upsert, -1, &Upsert, nullptr) != SQLITE_OK){
+        std::cerr << "Error creating the order store: " << (error ? error : sqlite3_errmsg(Database)) << "\n";
+        sqlite3_free(error);
+        sqlite3_close(Database);
+        throw std::runtime_error("Failed to create the order store");
+    }
+    Writer = std::thread(&Order_Store::write_loop, this);
+}
+
+// destructor
+// write what is pending, then close
+Order_Store::~Order_Store()
+{
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Running = false;
+    }
+    Ready.notify_one();
+    Writer.join();
+    sqlite3_finalize(Upsert);
+    sqlite3_close(Database);
+}
+
+
+// an "orders" table of an older version keeps its prices as REAL amounts of the currency : rebuild it with the prices in money units
+// false on error (the error message is set, the table is left as it was)
+bool Order_Store::migrate_prices(char*& error)
+{
+    sqlite3_stmt* stmt;
+    bool real_prices = false;
+    if (sqlite3_prepare_v2(Database, "PRAGMA table_info(orders)", -1, &stmt, nullptr) == SQLITE_OK){
+        while (sqlite3_step(stmt) == SQLITE_ROW){
+            const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)); // second column is the column name, third one its type
+            const char* type = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+            real_prices = real_prices || (name && type && std::string(name) == "price" && std::string(type) == "REAL");
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (!real_prices){
+        return true;
+    }
+
+    std::string migration = R"(
+        BEGIN;
+        CREATE TABLE orders_money (
+            order_id INTEGER PRIMARY KEY,
+            client_id INTEGER NOT NULL,
+            symbol TEXT NOT NULL,
+            order_type TEXT NOT NULL,
+            quantity INTEGER NOT NULL,
+            price INTEGER NOT NULL,
+            order_status TEXT NOT NULL
+        );
+        INSERT INTO orders_money SELECT order_id, client_id, symbol, order_type, quantity, CAST(ROUND(price * )" + std::to_string(MONEY_SCALE) + R"() AS INTEGER), order_status FROM orders;
+        DROP TABLE orders;
+        ALTER TABLE orders_money RENAME TO orders;
+        COMMIT;
+    )";
+    if (sqlite3_exec(Database, migration.c_str(), nullptr, nullptr, &error) != SQLITE_OK){
+        sqlite3_exec(Database, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    std::cout << "Order store: prices of the \"orders\" table converted to money units\n";
+    return true;
+}
+
+
+// take the pending updates and write them, until stopped and drained
+void Order_Store::write_loop()
+{
+    std::vector<Order_Update> batch;
+    while (true){
+        {
+            std::unique_lock<std::mutex> lock(Mutex);
+            Ready.wait(lock, [this]{ return !Pending.empty() || !Running; });
+            if (Pending.empty()){
+                return; // stopped and drained
+            }
+            batch.swap(Pending); // the updates pushed during the write wait for the next batch
+        }
+        write_batch(batch);
+        batch.clear();
+    }
+}
+
+// upsert the updates in one transaction
+void Order_Store::write_batch(const std::vector<Order_Update>& updates)
+{
+    sqlite3_exec(Database, "BEGIN;", nullptr, nullptr, nullptr);
+    for (const Order_Update& update : updates){
+        sqlite3_bind_int64(Upsert, 1, static_cast<sqlite3_int64>(update.order_id));
+        sqlite3_bind_int(Upsert, 2, update.client_id);
+        sqlite3_bind_text(Upsert, 3, update.symbol.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(Upsert, 4, update.buy ? "BUY" : "SELL", -1, SQLITE_STATIC);
+        sqlite3_bind_int(Upsert, 5, update.quantity);
+        sqlite3_bind_int64(Upsert, 6, update.price);
+        std::string status = order_status_to_string(update.status);
+        sqlite3_bind_text(Upsert, 7, status.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(Upsert) != SQLITE_DONE){
+            std::cerr << "Error writing order " << update.order_id << ": " << sqlite3_errmsg(Database) << "\n";
+        }
+        sqlite3_reset(Upsert);
+    }
+    sqlite3_exec(Database, "COMMIT;", nullptr, nullptr, nullptr);
+}
+
+
+// queue an update, never waits for SQLite
+void Order_Store::push(Order_Update update)
+{
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Pending.push_back(std::move(update));
+    }
+    Ready.notify_one();
+}
+
+
+// converting an Order_Status enum to a string
+std::string order_status_to_string(const Order_Status& status)
+{
+    switch (status){
+        case Order_Status::PENDING:
+            return "PENDING";
+        case Order_Status::COMPLETED:
+            return "COMPLETED";
+        case Order_Status::CANCELLED:
+            return "CANCELLED";
+        case Order_Status::EXPIRED:
+            return "EXPIRED";
+        default:
+            return "UNKNOWN";
+    }
+}
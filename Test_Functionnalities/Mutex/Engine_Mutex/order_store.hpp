@@ -0,0 +1,75 @@
+//==========================================================================
+// File that defines the asynchronous storage of the engine orders
+//==========================================================================
+#ifndef ORDER_STORE_HPP
+#define ORDER_STORE_HPP
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sqlite3.h>
+#include "price.hpp"
+
+
+#define ORDER_STORE_FILE "engine_orders.db"
+
+
+// state of an order row, as in the "orders" table of Src_App (plus CANCELLED and EXPIRED)
+enum class Order_Status : uint8_t
+{
+    PENDING,
+    COMPLETED,
+    CANCELLED,
+    EXPIRED // its expiration passed while it was in the book
+};
+
+
+// new state of an order, written as one row of the "orders" table
+struct Order_Update
+{
+    uint64_t order_id;
+    int client_id;
+    std::string symbol;
+    bool buy;
+    int quantity; // quantity left in the book (0 once completed, cancelled or expired)
+    Money price; // in money units, exact
+    Order_Status status;
+};
+
+
+// the matching code pushes the updates without waiting for SQLite, a writer thread upserts them by batches,
+// one transaction per batch, so a row is always the latest pushed state of its order
+class Order_Store
+{
+private:
+    sqlite3* Database;
+    sqlite3_stmt* Upsert; // INSERT ... ON CONFLICT(order_id) DO UPDATE
+    std::mutex Mutex; // protects the pending updates and Running
+    std::condition_variable Ready;
+    std::vector<Order_Update> Pending; // updates waiting for the writer
+    bool Running;
+    std::thread Writer;
+
+    bool migrate_prices(char*& error); // convert the REAL prices of a table created by an older version to money units, false on error
+    void write_loop(); // take the pending updates and write them, until stopped and drained
+    void write_batch(const std::vector<Order_Update>& updates); // upsert the updates in one transaction
+
+public:
+    // constructor
+    Order_Store(const std::string& filename = ORDER_STORE_FILE); // open the database, create the table and start the writer
+    // destructor
+    ~Order_Store(); // write what is pending, then close
+    Order_Store(const Order_Store&) = delete;
+    Order_Store& operator=(const Order_Store&) = delete;
+
+    void push(Order_Update update); // queue an update, never waits for SQLite
+};
+
+
+// converting an Order_Status enum to a string
+std::string order_status_to_string(const Order_Status& status);
+
+
+#endif // ORDER_STORE_HPP
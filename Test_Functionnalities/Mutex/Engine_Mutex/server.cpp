@@ -1,187 +1,253 @@
+#include <atomic>
+#include <ctime>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <thread>
 #include <mutex>
-#include <shared_mutex>
 #include <condition_variable>
-#include <queue>
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include "client_session.hpp"
+#include "matching_engine.hpp"
 
 #define PORT 8080
 #define BUFFER_SIZE 1024
+#define LISTED_SYMBOLS {"AAPL", "MSFT", "GOOG", "AMZN", "TSLA"} // listed at startup with the tickers given on the command line, the clients can not list any
 
-// ---------------- Order + Portfolio ----------------
-struct Order {
-    std::string type;        // BUY or SELL
-    int quantity;
-    std::string symbol;      // e.g. "AAPL"
-    std::string order_type;  // LIMIT for now
-    double price;
-    int client_id;           // to know who sent it
-};
-
+// ---------------- Portfolio ----------------
+// created once when the client connects, then only found : its address never changes and the map is never written while a matching thread reads it
 struct Portfolio {
-    double cash = 10000.0; // starting balance
-    std::map<std::string, int> holdings; // symbol -> shares
+    std::mutex mutex; // protects cash and holdings
+    Money cash = 10000 * MONEY_SCALE; // starting balance, in money units
+    std::map<Symbol_Id, int> holdings; // symbol -> shares
 };
 
-// ---------------- Order Book ----------------
-struct OrderCompareBuy {
-    bool operator()(const Order& a, const Order& b)
-    {
-        return a.price < b.price; // highest price first
-    }
-};
-struct OrderCompareSell {
-    bool operator()(const Order& a, const Order& b)
+// ---------------- Global State ----------------
+std::atomic<uint64_t> order_id_counter{1};
+Symbol_Registry symbols;                              // listed symbols : past the text protocol, a symbol is its id and a price its ticks
+Order_Store order_store;                              // orders table, written asynchronously
+std::unordered_map<int, std::shared_ptr<Portfolio>> portfolios; // client_id -> portfolio, kept after the disconnection for the resting orders
+std::mutex portfolios_mutex;                          // held to insert or find a portfolio, never while one is updated
+std::unordered_map<int, std::shared_ptr<Client_Session>> client_sessions; // client_id -> outbound queue of the connected clients
+std::mutex client_sessions_mutex;                     // held to find a session, never while sending
+
+// ---------------- Outbound Messages ----------------
+// queue a message for a client if still connected, the matching thread never waits for a socket
+void send_to_client(int client_id, const std::string& msg)
+{
+    std::shared_ptr<Client_Session> session;
     {
-        return a.price > b.price; // lowest price first
+        std::lock_guard<std::mutex> lock(client_sessions_mutex);
+        auto it = client_sessions.find(client_id);
+        if (it == client_sessions.end()){
+            return;
+        }
+        session = it->second;
     }
-};
-
-struct OrderBook {
-    std::priority_queue<Order, std::vector<Order>, OrderCompareBuy> buyOrders;
-    std::priority_queue<Order, std::vector<Order>, OrderCompareSell> sellOrders;
-};
+    session->push(msg);
+}
 
-// ---------------- Global State ----------------
-std::map<std::string, OrderBook> market;              // symbol -> orderbook
-std::unordered_map<int, Portfolio> portfolios;        // client_id -> portfolio
-std::unordered_map<std::string, std::shared_mutex> market_mutexes;
-std::unordered_map<int, std::mutex> portfolio_mutexes;
-std::unordered_map<int, int> client_sockets;          // client_id -> socket
-std::mutex client_sockets_mutex;
+// ---------------- Portfolios ----------------
+// portfolio of a client that connected once, nullptr otherwise
+std::shared_ptr<Portfolio> find_portfolio(int client_id)
+{
+    std::lock_guard<std::mutex> lock(portfolios_mutex);
+    auto it = portfolios.find(client_id);
+    return (it != portfolios.end()) ? it->second : nullptr;
+}
 
 // ---------------- Trade Execution ----------------
-void execute_trade(int buyer, int seller, const std::string& symbol, int qty, double price)
+void execute_trade(int buyer, int seller, Symbol_Id symbol, int qty, const Price& price)
 {
-    double total = qty * price;
+    Money total = get_notional(price, qty, symbols.get_tick_size(symbol)); // exact, the balances never drift
 
-    {
-        std::lock_guard<std::mutex> lock(portfolio_mutexes[buyer]);
-        portfolios[buyer].cash -= total;
-        portfolios[buyer].holdings[symbol] += qty;
+    if (std::shared_ptr<Portfolio> portfolio = find_portfolio(buyer)){
+        std::lock_guard<std::mutex> lock(portfolio->mutex);
+        portfolio->cash -= total;
+        portfolio->holdings[symbol] += qty;
     }
-    {
-        std::lock_guard<std::mutex> lock(portfolio_mutexes[seller]);
-        portfolios[seller].cash += total;
-        portfolios[seller].holdings[symbol] -= qty;
+    if (std::shared_ptr<Portfolio> portfolio = find_portfolio(seller)){
+        std::lock_guard<std::mutex> lock(portfolio->mutex);
+        portfolio->cash += total;
+        portfolio->holdings[symbol] -= qty;
     }
 
     std::ostringstream oss;
-    oss << "[TRADE] " << buyer << " bought " << qty << " " << symbol << " from " << seller << " @ " << price << "\n";
+    oss << "[TRADE] " << buyer << " bought " << qty << " " << symbols.get_symbol(symbol) << " from " << seller << " @ " << price_to_string(price, symbols.get_tick_size(symbol)) << "\n";
     std::string trade_msg = oss.str();
 
-    // Send trade to both buyer and seller if still connected
-    std::lock_guard<std::mutex> lock(client_sockets_mutex);
-    if (client_sockets.count(buyer))
-        send(client_sockets[buyer], trade_msg.c_str(), trade_msg.size(), 0);
-    if (client_sockets.count(seller))
-        send(client_sockets[seller], trade_msg.c_str(), trade_msg.size(), 0);
+    // queued for both buyer and seller if still connected, their writers send it after the matching
+    send_to_client(buyer, trade_msg);
+    send_to_client(seller, trade_msg);
 }
 
-// ---------------- Matching Engine ----------------
-void process_order(Order o)
+// ---------------- Engine Reports ----------------
+// text of a price of the symbol of a command
+std::string price_text(const Engine_Command& c, const Price& price)
 {
-    std::unique_lock<std::shared_mutex> lock(market_mutexes[o.symbol]);
-    auto& ob = market[o.symbol];
-
-    if (o.type == "BUY"){
-        while (!ob.sellOrders.empty() && ob.sellOrders.top().price <= o.price && o.quantity > 0){
-            Order sell = ob.sellOrders.top();
-            ob.sellOrders.pop();
-
-            int tradedQty = std::min(o.quantity, sell.quantity);
-            double tradePrice = sell.price; // fixing: seller’s ask wins
-
-            execute_trade(o.client_id, sell.client_id, o.symbol, tradedQty, tradePrice);
-
-            o.quantity -= tradedQty;
-            sell.quantity -= tradedQty;
+    return price_to_string(price, symbols.get_tick_size(c.symbol));
+}
 
-            if (sell.quantity > 0){
-                ob.sellOrders.push(sell);
+// text of a command, as the client sent it
+std::string command_to_string(const Engine_Command& c)
+{
+    const std::string& symbol = symbols.get_symbol(c.symbol);
+    std::ostringstream oss;
+    switch (c.type){
+        case Command_Type::NEW:
+            oss << ((c.side == Side::BUY) ? "BUY " : "SELL ") << c.quantity << " " << symbol;
+            switch (c.trigger){
+                case Order_Trigger::MARKET: oss << " MARKET"; break;
+                case Order_Trigger::LIMIT: oss << " LIMIT " << price_text(c, c.price); break;
+                case Order_Trigger::STOP: oss << " STOP " << price_text(c, c.trigger_price); break;
+                case Order_Trigger::LIMIT_STOP: oss << " LIMIT_STOP " << price_text(c, c.price) << " " << price_text(c, c.trigger_price); break;
             }
-        }
-        if (o.quantity > 0){
-            ob.buyOrders.push(o); // leftover goes to book
-        }
+            if (c.expiration > 0){
+                std::time_t seconds = c.expiration / 1000;
+                oss << " " << std::put_time(std::localtime(&seconds), "%Y-%m-%d %H:%M:%S");
+            }
+            break;
+        case Command_Type::CANCEL:
+            oss << "CANCEL " << symbol << " " << c.order_id;
+            break;
+        case Command_Type::AMEND:
+            oss << "AMEND " << symbol << " " << c.order_id << " " << c.quantity << " " << price_text(c, c.price);
+            break;
+        case Command_Type::VIEW:
+            oss << "VIEW MARKET " << symbol;
+            break;
+        case Command_Type::PHASE:
+            oss << "PHASE " << symbol << " " << trading_phase_to_string(c.phase);
+            break;
+        case Command_Type::EXPIRE:
+            oss << "order " << c.order_id << " " << ((c.side == Side::BUY) ? "BUY " : "SELL ") << c.quantity << " " << symbol << " @ " << price_text(c, c.price);
+            break;
+    }
+    return oss.str();
+}
+
+// called by the matching thread of the symbol once a command is processed : settle the fills and answer the client
+void report(const Engine_Command& c, const Engine_Result& r)
+{
+    for (const Fill& fill : r.fills){
+        execute_trade(fill.buyer, fill.seller, c.symbol, fill.quantity, fill.price);
     }
-    else if (o.type == "SELL") {
-        while (!ob.buyOrders.empty() && ob.buyOrders.top().price >= o.price && o.quantity > 0){
-            Order buy = ob.buyOrders.top();
-            ob.buyOrders.pop();
 
-            int tradedQty = std::min(o.quantity, buy.quantity);
-            double tradePrice = buy.price; // fixing: buyer’s bid wins
+    // stop orders triggered by the trades, market quantities without counterpart
+    for (const Order_Event& event : r.events){
+        std::ostringstream msg;
+        msg << ((event.type == Event_Type::TRIGGERED) ? "[TRIGGERED] order " : "[DROPPED] order ") << event.order_id
+            << " " << ((event.side == Side::BUY) ? "BUY " : "SELL ") << event.quantity << " " << symbols.get_symbol(c.symbol) << "\n";
+        send_to_client(event.client_id, msg.str());
+    }
 
-            execute_trade(buy.client_id, o.client_id, o.symbol, tradedQty, tradePrice);
+    std::ostringstream oss;
+    if (!r.accepted){
+        oss << "[REJECTED] client " << c.client_id << " -> " << command_to_string(c);
+    }
+    else if (c.type == Command_Type::NEW){
+        oss << "[ORDER] client " << c.client_id << " -> " << command_to_string(c) << " [ID " << c.order_id << "]";
+    }
+    else if (c.type == Command_Type::CANCEL){
+        oss << "[CANCELLED] client " << c.client_id << " -> order " << c.order_id;
+    }
+    else if (c.type == Command_Type::AMEND){
+        oss << "[AMENDED] client " << c.client_id << " -> order " << c.order_id << " " << c.quantity << " @ " << price_text(c, c.price);
+    }
+    else if (c.type == Command_Type::PHASE){
+        oss << "[PHASE] client " << c.client_id << " -> " << symbols.get_symbol(c.symbol) << " " << trading_phase_to_string(c.phase);
+    }
+    else if (c.type == Command_Type::EXPIRE){
+        // the portfolios are only moved by the trades, an expired order has nothing reserved to release
+        oss << "[EXPIRED] client " << c.client_id << " -> " << command_to_string(c) << "\n";
+    }
+    else {
+        oss << "Market for " << symbols.get_symbol(c.symbol) << "\n" << r.view;
+    }
+    send_to_client(c.client_id, oss.str());
+}
 
-            o.quantity -= tradedQty;
-            buy.quantity -= tradedQty;
+// read the symbol of a command, the stream fails if the ticker is not listed
+std::istringstream& read_symbol(std::istringstream& iss, Symbol_Id& symbol)
+{
+    std::string text;
+    if (iss >> text && (symbol = symbols.find(text)) == NO_SYMBOL){
+        iss.setstate(std::ios::failbit);
+    }
+    return iss;
+}
 
-            if (buy.quantity > 0){
-                ob.buyOrders.push(buy);
-            }
-        }
-        if (o.quantity > 0){
-            ob.sellOrders.push(o);
-        }
+// read a price of a symbol, the stream fails if it is not a positive multiple of the tick size of the symbol
+std::istringstream& read_price(std::istringstream& iss, const Symbol_Id& symbol, Price& price)
+{
+    std::string text;
+    if (iss >> text && !parse_price(text, symbols.get_tick_size(symbol), price)){
+        iss.setstate(std::ios::failbit);
     }
+    return iss;
 }
 
-// ---------------- Views ----------------
-std::string view_market(const std::string& symbol)
+// the notional of an order fits in a Money : its quantity at its limit price (at MAX_PRICE for a market or stop order) is at most MAX_NOTIONAL
+// a fill is never larger than its buying order, nor at a higher price than its limit, so get_notional cannot overflow on a trade
+bool check_notional(const Engine_Command& c)
 {
-    std::shared_lock<std::shared_mutex> lock(market_mutexes[symbol]);
-    auto& ob = market[symbol];
-    std::ostringstream oss;
+    Money tick_size = symbols.get_tick_size(c.symbol);
+    Price bound = (c.trigger == Order_Trigger::MARKET || c.trigger == Order_Trigger::STOP) ? Price(MAX_PRICE / tick_size) : c.price;
+    return fits_notional(bound, c.quantity, tick_size);
+}
 
-    oss << "Market for " << symbol << "\n";
-    oss << "  Buys: ";
-    auto copyB = ob.buyOrders;
-    while (!copyB.empty()){
-        auto o = copyB.top(); copyB.pop();
-        oss << "[" << o.quantity << "@" << o.price << "] ";
+// ms since epoch of a local "YYYY-MM-DD" "HH:MM:SS" expiration, false if it does not parse
+bool parse_expiration(const std::string& date, const std::string& time, int64_t& expiration)
+{
+    std::tm tm = {};
+    std::istringstream iss(date + " " + time);
+    iss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+    if (iss.fail()){
+        return false;
     }
-    oss << "\n  Sells: ";
-    auto copyS = ob.sellOrders;
-    while (!copyS.empty()){
-        auto o = copyS.top(); copyS.pop();
-        oss << "[" << o.quantity << "@" << o.price << "] ";
+    tm.tm_isdst = -1;
+    std::time_t seconds = std::mktime(&tm);
+    if (seconds <= 0){
+        return false;
     }
-    oss << "\n";
-    return oss.str();
+    expiration = int64_t(seconds) * 1000;
+    return true;
 }
 
-std::string view_portfolio(int client_id)
+// ---------------- Views ----------------
+std::string view_portfolio(Portfolio& p)
 {
-    std::lock_guard<std::mutex> lock(portfolio_mutexes[client_id]);
-    auto& p = portfolios[client_id];
+    std::lock_guard<std::mutex> lock(p.mutex);
     std::ostringstream oss;
-    oss << "Portfolio (cash=" << p.cash << "): ";
+    oss << "Portfolio (cash=" << money_to_string(p.cash) << "): ";
     for (auto& [sym, qty] : p.holdings){
-        oss << sym << "=" << qty << " ";
+        oss << symbols.get_symbol(sym) << "=" << qty << " ";
     }
     return oss.str();
 }
 
 // ---------------- Networking ----------------
-void handle_client(int client_socket, int client_id) 
+void handle_client(int client_socket, int client_id, Matching_Engine& engine)
 {
+    std::shared_ptr<Client_Session> session = std::make_shared<Client_Session>(client_socket);
     {
-        std::lock_guard<std::mutex> lock(client_sockets_mutex);
-        client_sockets[client_id] = client_socket;
+        std::lock_guard<std::mutex> lock(client_sessions_mutex);
+        client_sessions[client_id] = session;
     }
 
-    portfolios[client_id] = Portfolio();
-    portfolio_mutexes[client_id]; // ensure exists
+    std::shared_ptr<Portfolio> portfolio = std::make_shared<Portfolio>();
+    {
+        std::lock_guard<std::mutex> lock(portfolios_mutex);
+        portfolios[client_id] = portfolio; // before the first order of the client can trade
+    }
     char buffer[BUFFER_SIZE];
 
     while (true){
@@ -199,24 +265,97 @@ void handle_client(int client_socket, int client_id)
 
         std::string response;
 
+        // the commands of the book are answered by the matching thread of the symbol
         if (cmd == "BUY" || cmd == "SELL"){
-            Order o;
-            o.type = cmd;
-            iss >> o.quantity >> o.symbol >> o.order_type >> o.price;
-            o.client_id = client_id;
-
-            process_order(o);
-            response = "[ORDER] client " + std::to_string(client_id) + " -> " + input;
+            Engine_Command c{Command_Type::NEW, client_id, order_id_counter++, (cmd == "BUY") ? Side::BUY : Side::SELL, Order_Trigger::LIMIT, 0, Price(), Price(), 0, NO_SYMBOL};
+            std::string order_type; // MARKET, LIMIT <price>, STOP <trigger>, LIMIT_STOP <price> <trigger>, then optionally the expiration <YYYY-MM-DD> <HH:MM:SS>
+            iss >> c.quantity;
+            read_symbol(iss, c.symbol) >> order_type;
+            if (order_type == "MARKET"){
+                c.trigger = Order_Trigger::MARKET;
+            }
+            else if (order_type == "LIMIT"){
+                read_price(iss, c.symbol, c.price);
+            }
+            else if (order_type == "STOP"){
+                c.trigger = Order_Trigger::STOP;
+                read_price(iss, c.symbol, c.trigger_price);
+            }
+            else if (order_type == "LIMIT_STOP"){
+                c.trigger = Order_Trigger::LIMIT_STOP;
+                read_price(read_price(iss, c.symbol, c.price), c.symbol, c.trigger_price);
+            }
+            else {
+                iss.setstate(std::ios::failbit);
+            }
+            bool valid = !iss.fail() && check_notional(c);
+            std::string date, time;
+            if (valid && iss >> date){
+                valid = (iss >> time) && parse_expiration(date, time, c.expiration) && c.expiration > get_engine_time();
+            }
+            if (!valid){
+                response = "[REJECTED] client " + std::to_string(client_id) + " -> " + input;
+            }
+            else {
+                engine.submit(std::move(c));
+                continue;
+            }
+        }
+        else if (cmd == "CANCEL"){
+            Engine_Command c{Command_Type::CANCEL, client_id, 0, Side::BUY, Order_Trigger::LIMIT, 0, Price(), Price(), 0, NO_SYMBOL};
+            read_symbol(iss, c.symbol) >> c.order_id;
+            if (iss.fail()){
+                response = "[REJECTED] client " + std::to_string(client_id) + " -> " + input;
+            }
+            else {
+                engine.submit(std::move(c));
+                continue;
+            }
+        }
+        else if (cmd == "AMEND"){
+            Engine_Command c{Command_Type::AMEND, client_id, 0, Side::BUY, Order_Trigger::LIMIT, 0, Price(), Price(), 0, NO_SYMBOL};
+            read_symbol(iss, c.symbol) >> c.order_id >> c.quantity;
+            read_price(iss, c.symbol, c.price);
+            if (iss.fail() || !check_notional(c)){
+                response = "[REJECTED] client " + std::to_string(client_id) + " -> " + input;
+            }
+            else {
+                engine.submit(std::move(c));
+                continue;
+            }
+        }
+        else if (cmd == "PHASE"){
+            Engine_Command c{Command_Type::PHASE, client_id, 0, Side::BUY, Order_Trigger::LIMIT, 0, Price(), Price(), 0, NO_SYMBOL};
+            std::string phase;
+            read_symbol(iss, c.symbol) >> phase;
+            bool valid = false;
+            for (Trading_Phase p : {Trading_Phase::PRE_OPEN, Trading_Phase::OPEN, Trading_Phase::CONTINUOUS, Trading_Phase::PRE_CLOSE, Trading_Phase::CLOSE}){
+                if (phase == trading_phase_to_string(p)){
+                    c.phase = p;
+                    valid = true;
+                }
+            }
+            if (!valid || iss.fail()){
+                response = "[REJECTED] client " + std::to_string(client_id) + " -> " + input;
+            }
+            else {
+                engine.submit(std::move(c));
+                continue;
+            }
         }
         else if (cmd == "VIEW"){
             std::string what;
             iss >> what;
             if (what == "MARKET"){
-                std::string symbol; iss >> symbol;
-                response = view_market(symbol);
+                Engine_Command c{Command_Type::VIEW, client_id, 0, Side::BUY, Order_Trigger::LIMIT, 0, Price(), Price(), 0, NO_SYMBOL};
+                if (read_symbol(iss, c.symbol)){
+                    engine.submit(std::move(c));
+                    continue;
+                }
+                response = "[REJECTED] client " + std::to_string(client_id) + " -> " + input;
             } 
             else if (what == "PORTFOLIO"){
-                response = view_portfolio(client_id);
+                response = view_portfolio(*portfolio);
             } else {
                 response = "Unknown VIEW option";
             }
@@ -224,18 +363,20 @@ void handle_client(int client_socket, int client_id)
             response = "Unknown command";
         }
 
-        send(client_socket, response.c_str(), response.size(), 0);
+        session->push(response); // after the answers of the engine already queued
     }
 
     {
-        std::lock_guard<std::mutex> lock(client_sockets_mutex);
-        client_sockets.erase(client_id);
+        std::lock_guard<std::mutex> lock(client_sessions_mutex);
+        client_sessions.erase(client_id);
     }
+    session->stop(); // a report still holding the session only queues into a closed one, and no other thread touches the socket from here
 
     close(client_socket);
 }
 
-int main()
+// server.x [ticker ...] : the tickers are listed after LISTED_SYMBOLS
+int main(int argc, char* argv[])
 {
     int server_fd, client_socket;
     struct sockaddr_in address;
@@ -262,6 +403,17 @@ int main()
     }
     std::cout << "Server listening on port " << PORT << "...\n";
 
+    for (const std::string symbol : LISTED_SYMBOLS){
+        symbols.add(symbol);
+    }
+    for (int i = 1; i < argc; ++i){
+        if (symbols.add(argv[i]) == NO_SYMBOL){
+            std::cerr << "Error: " << argv[i] << " can not be listed\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+    Matching_Engine engine(report, symbols, &order_store);
+
     while (true){
         if ((client_socket = accept(server_fd, (struct sockaddr*)&address, &addr_len)) < 0) {
             perror("Error accept");
@@ -269,7 +421,7 @@ int main()
         }
         int client_id = client_id_counter++;
         std::cout << "Client " << client_id << " connected!\n";
-        std::thread(handle_client, client_socket, client_id).detach();
+        std::thread(handle_client, client_socket, client_id, std::ref(engine)).detach();
     }
 
     close(server_fd);
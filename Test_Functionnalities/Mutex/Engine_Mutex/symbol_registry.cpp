@@ -0,0 +1,88 @@
+#include "symbol_registry.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+
+// constructor
+// simple init
+Symbol_Registry::Symbol_Registry(const Tick_Sizes& ticks, const size_t& capacity) : Ticks(ticks), Capacity(capacity), Symbols(new std::string[capacity]), Tick_Size_Of(new Money[capacity]), Count(0)
+{
+    if (capacity == 0 || capacity > NO_SYMBOL){
+        std::cerr << "Error: the registry must hold between 1 and " << NO_SYMBOL << " symbols\n";
+        throw std::runtime_error("Invalid registry capacity");
+    }
+    Ids.reserve(capacity);
+}
+
+
+// getters
+size_t Symbol_Registry::size() const
+{
+    return Count.load(std::memory_order_acquire);
+}
+
+size_t Symbol_Registry::get_capacity() const
+{
+    return Capacity;
+}
+
+// id of a listed ticker, NO_SYMBOL otherwise
+Symbol_Id Symbol_Registry::find(const std::string& symbol) const
+{
+    std::shared_lock<std::shared_mutex> lock(Mutex);
+    auto it = Ids.find(symbol);
+    return (it != Ids.end()) ? it->second : NO_SYMBOL;
+}
+
+bool Symbol_Registry::is_listed(const Symbol_Id& id) const
+{
+    return id < Count.load(std::memory_order_acquire);
+}
+
+// ticker of a listed id
+const std::string& Symbol_Registry::get_symbol(const Symbol_Id& id) const
+{
+    return Symbols[id];
+}
+
+// tick size of a listed id
+Money Symbol_Registry::get_tick_size(const Symbol_Id& id) const
+{
+    return Tick_Size_Of[id];
+}
+
+
+// listing
+// list a ticker (its id if it already is), NO_SYMBOL if it is not a valid ticker or the registry is full
+// a ticker is 1 to MAX_SYMBOL_LENGTH letters, digits, '.' or '-'
+Symbol_Id Symbol_Registry::add(const std::string& symbol)
+{
+    Symbol_Id id = find(symbol);
+    if (id != NO_SYMBOL){
+        return id;
+    }
+    bool valid = !symbol.empty() && symbol.size() <= MAX_SYMBOL_LENGTH && std::all_of(symbol.begin(), symbol.end(), [](const char& c){
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '-';
+    });
+    if (!valid){
+        return NO_SYMBOL;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(Mutex);
+    auto it = Ids.find(symbol); // listed by another thread meanwhile
+    if (it != Ids.end()){
+        return it->second;
+    }
+    id = Count.load(std::memory_order_relaxed);
+    if (id >= Capacity){
+        return NO_SYMBOL;
+    }
+    Symbols[id] = symbol;
+    Tick_Size_Of[id] = Ticks.get(symbol);
+    Ids.emplace(symbol, id);
+    Count.store(id + 1, std::memory_order_release); // publishes the slots of the id
+    return id;
+}
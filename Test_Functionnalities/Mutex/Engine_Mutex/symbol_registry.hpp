@@ -0,0 +1,56 @@
+//==========================================================================
+// File that defines the listed symbols of the engine and their dense ids
+//==========================================================================
+#ifndef SYMBOL_REGISTRY_HPP
+#define SYMBOL_REGISTRY_HPP
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include "price.hpp"
+
+
+#define MAX_SYMBOLS 1024 // listings the registry can hold, the engine sizes its book array once for all of them
+#define MAX_SYMBOL_LENGTH 15 // longest ticker, short enough to stay in the std::string itself
+#define NO_SYMBOL UINT32_MAX // id of a symbol that is not listed
+
+
+using Symbol_Id = uint32_t; // index of a listed symbol, 0 for the first one
+
+
+// interns the tickers : a symbol is listed once, at startup, and gets the next dense id, the order entry only looks the listed ones up
+// past the order entry, the engine and the reports only carry the id : the book, the tick size and the text of a symbol are read by index
+// listing and looking a ticker up take the lock, reading by id does not : the slots of an id are written before the count publishes it, and never change afterwards
+class Symbol_Registry
+{
+private:
+    Tick_Sizes Ticks; // tick size given to each symbol when it is listed
+    size_t Capacity;
+    std::unique_ptr<std::string[]> Symbols; // id -> ticker
+    std::unique_ptr<Money[]> Tick_Size_Of; // id -> tick size
+    std::unordered_map<std::string, Symbol_Id> Ids; // ticker -> id
+    std::atomic<uint32_t> Count; // listed symbols
+    mutable std::shared_mutex Mutex; // protects Ids and the listing
+
+public:
+    // constructor
+    Symbol_Registry(const Tick_Sizes& ticks = Tick_Sizes(), const size_t& capacity = MAX_SYMBOLS); // simple init
+    Symbol_Registry(const Symbol_Registry&) = delete;
+    Symbol_Registry& operator=(const Symbol_Registry&) = delete;
+
+    // getters
+    size_t size() const; // listed symbols
+    size_t get_capacity() const;
+    Symbol_Id find(const std::string& symbol) const; // id of a listed ticker, NO_SYMBOL otherwise
+    bool is_listed(const Symbol_Id& id) const;
+    const std::string& get_symbol(const Symbol_Id& id) const; // ticker of a listed id
+    Money get_tick_size(const Symbol_Id& id) const; // tick size of a listed id
+
+    // listing
+    Symbol_Id add(const std::string& symbol); // list a ticker (its id if it already is), NO_SYMBOL if it is not a valid ticker or the registry is full
+};
+
+
+#endif // SYMBOL_REGISTRY_HPP
@@ -0,0 +1,177 @@
+//==========================================================================
+// File that defines the hierarchical timer wheel expiring the engine orders
+//==========================================================================
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+#define TIMER_WHEEL_BITS 6 // 64 slots per level
+#define TIMER_WHEEL_LEVELS 5 // the wheel spans 64^5 ticks, later deadlines wait in the last level and are placed again
+
+
+// hierarchical timer wheel : level l has 64 slots of 64^l ticks each, a timer sits in the lowest level whose span covers its deadline
+// advancing one tick fires the slot of level 0, and when a level wraps, the next slot of the level above is spread over the levels below,
+// so scheduling, cancelling and firing are O(1) per timer whatever the number of timers
+// the timers are keyed (an order id) so a cancel reaches its node through the index, the value is given back when the timer fires
+template <typename T>
+class Timer_Wheel
+{
+private:
+    static constexpr int64_t SLOT_COUNT = int64_t(1) << TIMER_WHEEL_BITS;
+    static constexpr int64_t SLOT_MASK = SLOT_COUNT - 1;
+    static constexpr int64_t SPAN = int64_t(1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS); // ticks covered by the wheel
+
+    // node of the list of its slot
+    struct Timer
+    {
+        uint64_t key;
+        int64_t deadline; // tick at which the timer fires
+        T value;
+        size_t slot; // index in Slots
+        Timer* prev;
+        Timer* next;
+    };
+
+    std::vector<Timer*> Slots; // TIMER_WHEEL_LEVELS x SLOT_COUNT list heads
+    std::unordered_map<uint64_t, Timer*> Timers; // key -> timer
+    int64_t Current; // last tick advanced to
+
+    // link a timer in the slot of its deadline, relative to the current tick (no earlier than the tick from)
+    void place(Timer* timer, const int64_t& from)
+    {
+        int64_t tick = std::max(timer->deadline, from);
+        int64_t delta = std::min(tick - Current, SPAN - 1); // beyond the wheel : the farthest slot, placed again when it cascades
+        tick = Current + delta;
+        int level = 0;
+        while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (int64_t(1) << (TIMER_WHEEL_BITS * (level + 1)))){
+            ++level;
+        }
+        timer->slot = level * SLOT_COUNT + ((tick >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK);
+        timer->prev = nullptr;
+        timer->next = Slots[timer->slot];
+        if (timer->next != nullptr){
+            timer->next->prev = timer;
+        }
+        Slots[timer->slot] = timer;
+    }
+
+    // unlink a timer from its slot (the node is not freed)
+    void unlink(Timer* timer)
+    {
+        if (timer->prev != nullptr){
+            timer->prev->next = timer->next;
+        }
+        else {
+            Slots[timer->slot] = timer->next;
+        }
+        if (timer->next != nullptr){
+            timer->next->prev = timer->prev;
+        }
+    }
+
+    // spread the timers of a slot over the lower levels
+    void cascade(const size_t& slot)
+    {
+        Timer* timer = Slots[slot];
+        Slots[slot] = nullptr;
+        while (timer != nullptr){
+            Timer* next = timer->next;
+            place(timer, Current);
+            timer = next;
+        }
+    }
+
+public:
+    // constructor
+    // simple init, the wheel starts at a tick
+    explicit Timer_Wheel(const int64_t& current_tick = 0) : Slots(TIMER_WHEEL_LEVELS * SLOT_COUNT, nullptr), Current(current_tick)
+    {
+
+    }
+    // destructor
+    // free the timers left
+    ~Timer_Wheel()
+    {
+        for (const auto& [key, timer] : Timers){
+            delete timer;
+        }
+    }
+    Timer_Wheel(const Timer_Wheel&) = delete;
+    Timer_Wheel& operator=(const Timer_Wheel&) = delete;
+
+    // getters
+    size_t size() const
+    {
+        return Timers.size();
+    }
+
+    int64_t get_current_tick() const
+    {
+        return Current;
+    }
+
+    // add a timer, a deadline already passed fires at the next tick, false if the key is already scheduled
+    bool schedule(const uint64_t& key, const int64_t& deadline, const T& value)
+    {
+        if (Timers.count(key) > 0){
+            return false;
+        }
+        Timer* timer = new Timer{key, deadline, value, 0, nullptr, nullptr};
+        Timers.emplace(key, timer);
+        place(timer, Current + 1);
+        return true;
+    }
+
+    // remove a timer in O(1), false if the key is not scheduled
+    bool cancel(const uint64_t& key)
+    {
+        auto it = Timers.find(key);
+        if (it == Timers.end()){
+            return false;
+        }
+        unlink(it->second);
+        delete it->second;
+        Timers.erase(it);
+        return true;
+    }
+
+    // move to a tick and fire the timers whose deadline is reached, in deadline order (by slot), expire(key, value) is called once per timer
+    template <typename Expire>
+    void advance(const int64_t& tick, Expire&& expire)
+    {
+        if (Timers.empty()){
+            Current = std::max(Current, tick); // nothing to walk
+            return;
+        }
+        while (Current < tick){
+            ++Current;
+            // the levels that wrap at this tick hand their next slot down, the highest first
+            for (int level = TIMER_WHEEL_LEVELS - 1; level > 0; --level){
+                int64_t shift = TIMER_WHEEL_BITS * level;
+                if ((Current & ((int64_t(1) << shift) - 1)) == 0){
+                    cascade(level * SLOT_COUNT + ((Current >> shift) & SLOT_MASK));
+                }
+            }
+            // fire the slot of level 0
+            Timer* timer = Slots[Current & SLOT_MASK];
+            Slots[Current & SLOT_MASK] = nullptr;
+            while (timer != nullptr){
+                Timer* next = timer->next;
+                Timers.erase(timer->key);
+                expire(timer->key, timer->value);
+                delete timer;
+                timer = next;
+            }
+            if (Timers.empty()){
+                Current = tick;
+            }
+        }
+    }
+};
+
+
+#endif // TIMER_WHEEL_HPP
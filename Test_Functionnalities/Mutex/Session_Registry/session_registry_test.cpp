@@ -0,0 +1,147 @@
+#include "session_registry.hpp"
+
+
+#define DATABASE_FILE "session_registry.db"
+#define CLIENT_COUNT 64
+#define DEFAULT_THREADS 16
+#define ROUNDS_PER_THREAD 2000
+
+
+// remove the database file and everything SQLite may have left next to it
+void remove_database_files()
+{
+    for (const std::string suffix : {"", "-journal", "-wal", "-shm"}){
+        std::filesystem::remove(DATABASE_FILE + suffix);
+    }
+}
+
+// fresh database with CLIENT_COUNT clients
+void populate(Database_Manager& database)
+{
+    database.create_tables();
+    database.execute_SQL("BEGIN;");
+    for (int client_id = 1; client_id <= CLIENT_COUNT; ++client_id){
+        database.execute_SQL(fmt::format("INSERT INTO clients (client_id, name, encrypted_password, balance) VALUES ({}, 'client_{}', x'00', {})", client_id, client_id, 1000 * MONEY_SCALE));
+    }
+    database.execute_SQL("COMMIT;");
+}
+
+// print the result of a check and return it
+bool report(const std::string& name, const bool& ok)
+{
+    fmt::print("{:<44} {}\n", name, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+// a logout frees the slot for the next login, and the handle of the former session is refused in the reused slot
+bool run_reuse(Database_Manager& database)
+{
+    Session_Registry registry(database);
+    Session_Handle first = registry.login(1);
+    bool same_handle = registry.login(1).index == first.index && registry.login(1).generation == first.generation;
+    bool logged_out = registry.logout(first);
+    Session_Handle second = registry.login(2);
+
+    bool reused = second.index == first.index && second.generation != first.generation && registry.get_slot_count() == 1;
+    bool stale_refused = !registry.is_valid(first) && !registry.borrow(first) && !registry.logout(first) && registry.find(1).index == SESSION_NO_INDEX;
+    Session_Lease lease = registry.borrow(second);
+    bool current_borrowed = lease && lease->get_id() == 2 && registry.is_valid(second);
+    bool default_refused = !registry.is_valid(Session_Handle{}) && !registry.borrow(Session_Handle{});
+
+    bool ok = report("login twice gives the same handle", same_handle);
+    ok = report("logout, then the slot is reused", logged_out && reused) && ok;
+    ok = report("stale generation refused in the reused slot", stale_refused) && ok;
+    ok = report("current handle borrowed", current_borrowed) && ok;
+    return report("default handle refused", default_refused) && ok;
+}
+
+// a lease keeps its client across a logout made by its own thread, and the slot is only reused once the lease ends
+bool run_lease(Database_Manager& database)
+{
+    Session_Registry registry(database);
+    Session_Handle handle = registry.login(1);
+    bool kept = false;
+    bool not_reused = false;
+    bool relogged = false;
+    {
+        Session_Lease lease = registry.borrow(handle);
+        bool logged_out = registry.logout(handle); // would wait forever on a lease holding the registry lock
+        kept = logged_out && lease && lease->get_id() == 1 && !registry.is_valid(handle);
+        Session_Handle other = registry.login(2);
+        not_reused = other.index != handle.index;
+        Session_Handle again = registry.login(1); // the client logs in again while its former session is still borrowed
+        relogged = again.index != handle.index && registry.is_valid(again) && registry.borrow(again)->get_id() == 1;
+    }
+    Session_Handle next = registry.login(3);
+    bool released = next.index == handle.index && next.generation != handle.generation && registry.get_slot_count() == 3;
+
+    bool ok = report("lease kept across a logout of its own thread", kept);
+    ok = report("pinned slot not reused", not_reused) && ok;
+    ok = report("client logged in again while borrowed", relogged) && ok;
+    return report("slot reused once the lease ended", released) && ok;
+}
+
+// every thread logs its clients in and out while the others borrow them through handles that may be stale
+bool run_concurrent(Database_Manager& database, const int& threads)
+{
+    Session_Registry registry(database);
+    std::atomic<int> wrong_client{0};
+    std::atomic<int> borrowed{0};
+    std::atomic<int> refused{0};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t){
+        workers.emplace_back([&, t](){
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<int> client_dist(1, CLIENT_COUNT);
+            for (int i = 0; i < ROUNDS_PER_THREAD; ++i){
+                ID client_id = client_dist(gen);
+                Session_Handle handle = (i % 2 == 0) ? registry.login(client_id) : registry.find(client_id);
+                Session_Lease lease = registry.borrow(handle);
+                if (!lease){
+                    ++refused; // logged out by another thread meanwhile
+                    continue;
+                }
+                ++borrowed;
+                if (i % 3 == 0){
+                    registry.logout(handle); // the lease is still held
+                }
+                if (lease->get_id() != client_id){
+                    ++wrong_client;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers){
+        worker.join();
+    }
+    registry.clear();
+    bool cleared = registry.get_session_count() == 0 && registry.get_slot_count() <= static_cast<size_t>(CLIENT_COUNT + threads);
+
+    fmt::print("{} threads : {} borrowed, {} stale handles refused, {} slots\n", threads, borrowed.load(), refused.load(), registry.get_slot_count());
+    bool ok = report("every lease gives the client of its handle", wrong_client == 0);
+    return report("every session logged out, slots bounded", cleared) && ok;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int threads = (argc > 1) ? std::stoi(argv[1]) : DEFAULT_THREADS;
+    if (threads <= 0){
+        std::cerr << "Error: the number of threads must be positive.\n";
+        return 1;
+    }
+
+    remove_database_files();
+    bool ok = false;
+    {
+        Database_Manager database(DATABASE_FILE, Database_Profile::BALANCED);
+        populate(database);
+        ok = run_reuse(database);
+        ok = run_lease(database) && ok;
+        ok = run_concurrent(database, threads) && ok;
+        database.close_database();
+    }
+    remove_database_files();
+    return ok ? 0 : 1;
+}